@@ -0,0 +1,119 @@
+#include <algorithm>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QTextStream>
+
+#include <benchmarkutils.h>
+
+#include <CoreApi/filelocker.h>
+
+// Measures the latency of FileLocker::save() in each save mode for several document sizes.
+// The target directory decides the file system, pass one on the storage of interest.
+
+using Core::FileLocker;
+
+static bool runMode(const QString &filePath, FileLocker::SaveMode mode, const QByteArray &data,
+                    int runs, QList<double> *samples, QString *errorMessage) {
+    {
+        QFile file(filePath);
+        if (!file.open(QIODevice::WriteOnly)) {
+            *errorMessage = file.errorString();
+            return false;
+        }
+    }
+
+    FileLocker locker;
+    locker.setSaveMode(mode);
+    if (!locker.open(filePath)) {
+        *errorMessage = locker.errorString();
+        return false;
+    }
+
+    for (int i = 0; i < runs; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        if (!locker.save(data)) {
+            *errorMessage = locker.errorString();
+            return false;
+        }
+        samples->append(double(timer.nsecsElapsed()) / 1e6);
+    }
+    locker.close();
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("ChorusKit FileLocker save benchmark"));
+    parser.addHelpOption();
+
+    QCommandLineOption sizesOption(QStringLiteral("sizes"),
+                                   QStringLiteral("Comma separated document sizes in KiB."),
+                                   QStringLiteral("list"), QStringLiteral("4,1024,65536"));
+    QCommandLineOption runsOption(QStringLiteral("runs"),
+                                  QStringLiteral("Saves per mode and size."),
+                                  QStringLiteral("count"), QStringLiteral("20"));
+    QCommandLineOption dirOption(
+        QStringLiteral("dir"),
+        QStringLiteral("Directory to save in, the temporary directory by default."),
+        QStringLiteral("path"));
+    parser.addOptions({sizesOption, runsOption, dirOption});
+    parser.process(a);
+
+    const int runs = std::max(1, parser.value(runsOption).toInt());
+
+    const QString baseDir = parser.isSet(dirOption) ? parser.value(dirOption) : QDir::tempPath();
+    QTemporaryDir tempDir(QDir(baseDir).filePath(QStringLiteral("ckbench-XXXXXX")));
+    QTextStream out(stdout);
+    if (!tempDir.isValid()) {
+        out << "failed to create the working directory: " << tempDir.errorString() << Qt::endl;
+        return 1;
+    }
+    const QString filePath = tempDir.filePath(QStringLiteral("document.bin"));
+
+    const struct {
+        FileLocker::SaveMode mode;
+        const char *name;
+    } modes[] = {
+        {FileLocker::InPlace, "in_place"},
+        {FileLocker::Atomic,  "atomic"  },
+    };
+
+    out << qSetFieldWidth(10) << Qt::left << "mode" << qSetFieldWidth(12) << Qt::right
+        << "size_kib" << "median_ms" << "p90_ms" << "min_ms" << "max_ms" << qSetFieldWidth(0)
+        << Qt::endl;
+
+    int failures = 0;
+    const auto sizes = parser.value(sizesOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const auto &sizeText : sizes) {
+        const qint64 sizeKib = std::max(1, sizeText.trimmed().toInt());
+        QByteArray data(sizeKib * 1024, Qt::Uninitialized);
+        for (qsizetype i = 0; i < data.size(); ++i) {
+            data[i] = char(i * 31);
+        }
+
+        for (const auto &item : modes) {
+            QList<double> samples;
+            QString errorMessage;
+            if (!runMode(filePath, item.mode, data, runs, &samples, &errorMessage)) {
+                out << item.name << ": " << errorMessage << Qt::endl;
+                failures++;
+                continue;
+            }
+            out << qSetFieldWidth(10) << Qt::left << item.name << qSetFieldWidth(12) << Qt::right
+                << sizeKib << qSetRealNumberPrecision(4) << Bench::percentile(samples, 0.5)
+                << Bench::percentile(samples, 0.9)
+                << *std::min_element(samples.begin(), samples.end())
+                << *std::max_element(samples.begin(), samples.end()) << qSetFieldWidth(0)
+                << Qt::endl;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
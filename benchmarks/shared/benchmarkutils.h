@@ -0,0 +1,23 @@
+#ifndef CKBENCH_BENCHMARKUTILS_H
+#define CKBENCH_BENCHMARKUTILS_H
+
+#include <algorithm>
+
+#include <QtCore/QList>
+
+namespace Bench {
+
+    // Linear interpolation between the closest ranks, \a p is in [0, 1]
+    inline double percentile(QList<double> values, double p) {
+        if (values.isEmpty())
+            return 0;
+        std::sort(values.begin(), values.end());
+        double pos = p * double(values.size() - 1);
+        auto lower = qsizetype(pos);
+        auto upper = std::min(lower + 1, values.size() - 1);
+        return values[lower] + (values[upper] - values[lower]) * (pos - double(lower));
+    }
+
+}
+
+#endif // CKBENCH_BENCHMARKUTILS_H
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QProcess>
+#include <QtCore/QTextStream>
+#include <QtCore/QUuid>
+
+#include <benchmarkutils.h>
+
+#include <SingleApplication>
+
+// Measures the message throughput between a primary and a secondary instance. The benchmark
+// spawns itself as the primary instance and sends messages to it from this process. The burst
+// mode launches many secondary processes at once and reports their connection latency.
+
+static const char READY_LINE[] = "ready";
+static const char QUIT_MESSAGE[] = "quit";
+static const char LATENCY_PREFIX[] = "latency_ms=";
+
+static const SingleApplication::Options options = SingleApplication::User |
+                                                  SingleApplication::ExcludeAppPath |
+                                                  SingleApplication::ExcludeAppVersion;
+
+static int runPrimary(const QString &key) {
+    SingleApplication single(nullptr, true, options, 1000, key);
+    if (!single.isPrimary()) {
+        QTextStream(stderr) << "another primary instance is running" << Qt::endl;
+        return 1;
+    }
+
+    QObject::connect(&single, &SingleApplication::receivedMessage,
+                     [](quint32 instanceId, const QByteArray &message) {
+                         Q_UNUSED(instanceId)
+                         if (message == QUIT_MESSAGE)
+                             QCoreApplication::quit();
+                     });
+
+    QTextStream(stdout) << READY_LINE << Qt::endl;
+    return QCoreApplication::exec();
+}
+
+static int runSecondary(const QString &key, int timeout) {
+    QElapsedTimer timer;
+    timer.start();
+
+    SingleApplication single(nullptr, true, options, timeout, key);
+    if (!single.sendMessage(QByteArrayLiteral("burst"), timeout))
+        return 1;
+
+    QTextStream(stdout) << LATENCY_PREFIX << double(timer.nsecsElapsed()) / 1e6 << Qt::endl;
+    return 0;
+}
+
+// Launches all secondaries at once, each one measures the time from its start to the
+// acknowledgement of its message
+static int runBurst(const QString &key, int processes, int timeout, QTextStream &out) {
+    std::vector<std::unique_ptr<QProcess>> children;
+    children.reserve(size_t(processes));
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < processes; ++i) {
+        auto child = std::make_unique<QProcess>();
+        child->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+        child->start(QCoreApplication::applicationFilePath(),
+                     {QStringLiteral("--secondary"), key, QStringLiteral("--timeout"),
+                      QString::number(timeout)});
+        children.push_back(std::move(child));
+    }
+
+    int failures = 0;
+    QList<double> latencies;
+    for (const auto &child : children) {
+        if (!child->waitForFinished(timeout) || child->exitCode() != 0) {
+            child->kill();
+            child->waitForFinished();
+            failures++;
+            continue;
+        }
+        const QByteArray line = child->readAllStandardOutput().trimmed();
+        if (!line.startsWith(LATENCY_PREFIX)) {
+            failures++;
+            continue;
+        }
+        latencies.append(line.mid(int(sizeof(LATENCY_PREFIX)) - 1).toDouble());
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    out << "CKBENCH mode=burst processes=" << processes << " wall_ms=" << double(elapsed) / 1e6
+        << " latency_median_ms=" << Bench::percentile(latencies, 0.5)
+        << " latency_p90_ms=" << Bench::percentile(latencies, 0.9) << " latency_max_ms="
+        << (latencies.isEmpty() ? 0 : *std::max_element(latencies.begin(), latencies.end()))
+        << " failures=" << failures << Qt::endl;
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    a.setApplicationName(QStringLiteral("ckbench_singleapplication"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("ChorusKit SingleApplication benchmark"));
+    parser.addHelpOption();
+
+    QCommandLineOption modeOption(
+        QStringLiteral("mode"),
+        QStringLiteral("single: one sendMessage() per message, batch: queueMessage() and "
+                       "flushMessages() per batch, reconnect: a new secondary per message, "
+                       "burst: concurrently launched secondary processes."),
+        QStringLiteral("mode"), QStringLiteral("single"));
+    QCommandLineOption messagesOption(QStringLiteral("messages"),
+                                      QStringLiteral("Number of messages to send."),
+                                      QStringLiteral("count"), QStringLiteral("10000"));
+    QCommandLineOption batchOption(QStringLiteral("batch"),
+                                   QStringLiteral("Messages per flush in batch mode."),
+                                   QStringLiteral("count"), QStringLiteral("64"));
+    QCommandLineOption sizeOption(QStringLiteral("size"),
+                                  QStringLiteral("Payload size of each message in bytes."),
+                                  QStringLiteral("bytes"), QStringLiteral("256"));
+    QCommandLineOption timeoutOption(QStringLiteral("timeout"),
+                                     QStringLiteral("Timeout of each send in milliseconds."),
+                                     QStringLiteral("ms"), QStringLiteral("5000"));
+    QCommandLineOption processesOption(QStringLiteral("processes"),
+                                       QStringLiteral("Secondary processes in burst mode."),
+                                       QStringLiteral("count"), QStringLiteral("32"));
+    QCommandLineOption primaryOption(QStringLiteral("primary"),
+                                     QStringLiteral("Run as the primary instance (internal)."),
+                                     QStringLiteral("key"));
+    QCommandLineOption secondaryOption(
+        QStringLiteral("secondary"),
+        QStringLiteral("Run as a secondary instance of the burst mode (internal)."),
+        QStringLiteral("key"));
+    parser.addOptions({modeOption, messagesOption, batchOption, sizeOption, timeoutOption,
+                       processesOption, primaryOption, secondaryOption});
+    parser.process(a);
+
+    if (parser.isSet(primaryOption)) {
+        return runPrimary(parser.value(primaryOption));
+    }
+    if (parser.isSet(secondaryOption)) {
+        return runSecondary(parser.value(secondaryOption), parser.value(timeoutOption).toInt());
+    }
+
+    const QString mode = parser.value(modeOption);
+    const int messages = std::max(1, parser.value(messagesOption).toInt());
+    const int batch = std::max(1, parser.value(batchOption).toInt());
+    const int timeout = parser.value(timeoutOption).toInt();
+    const QByteArray payload(std::max(1, parser.value(sizeOption).toInt()), 'x');
+
+    QTextStream out(stdout);
+    if (mode != QLatin1String("single") && mode != QLatin1String("batch") &&
+        mode != QLatin1String("reconnect") && mode != QLatin1String("burst")) {
+        out << "unknown mode: " << mode << Qt::endl;
+        return 1;
+    }
+
+    // A unique key keeps the benchmark away from other instances
+    const QString key = QUuid::createUuid().toString(QUuid::WithoutBraces);
+
+    QProcess primary;
+    primary.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    primary.start(QCoreApplication::applicationFilePath(), {QStringLiteral("--primary"), key});
+    if (!primary.waitForStarted(timeout) || !primary.waitForReadyRead(timeout) ||
+        !primary.readLine().startsWith(READY_LINE)) {
+        out << "failed to start the primary instance" << Qt::endl;
+        primary.kill();
+        primary.waitForFinished();
+        return 1;
+    }
+
+    if (mode == QLatin1String("burst")) {
+        const int processes = std::max(1, parser.value(processesOption).toInt());
+        const int failures = runBurst(key, processes, timeout, out);
+
+        SingleApplication single(nullptr, true, options, timeout, key);
+        single.sendMessage(QUIT_MESSAGE, timeout);
+        if (!primary.waitForFinished(timeout)) {
+            primary.kill();
+            primary.waitForFinished();
+        }
+        return failures == 0 ? 0 : 1;
+    }
+
+    auto single = std::make_unique<SingleApplication>(nullptr, true, options, timeout, key);
+
+    int failures = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    if (mode == QLatin1String("single")) {
+        for (int i = 0; i < messages; ++i) {
+            if (!single->sendMessage(payload, timeout))
+                failures++;
+        }
+    } else if (mode == QLatin1String("batch")) {
+        for (int i = 0; i < messages; i += batch) {
+            const int count = std::min(batch, messages - i);
+            for (int j = 0; j < count; ++j)
+                single->queueMessage(payload);
+            if (!single->flushMessages(timeout))
+                failures += count;
+        }
+    } else {
+        // Each launch of a secondary instance pays for the shared memory and the connection
+        for (int i = 0; i < messages; ++i) {
+            single = std::make_unique<SingleApplication>(nullptr, true, options, timeout, key);
+            if (!single->sendMessage(payload, timeout))
+                failures++;
+        }
+    }
+
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    single->sendMessage(QUIT_MESSAGE, timeout);
+    single.reset();
+    if (!primary.waitForFinished(timeout)) {
+        primary.kill();
+        primary.waitForFinished();
+    }
+
+    const double seconds = double(elapsed) / 1e9;
+    out << "CKBENCH mode=" << mode << " messages=" << messages << " size=" << payload.size()
+        << " batch=" << (mode == QLatin1String("batch") ? batch : 1)
+        << " elapsed_ms=" << double(elapsed) / 1e6
+        << " messages_per_sec=" << (seconds > 0 ? double(messages - failures) / seconds : 0)
+        << " failures=" << failures << Qt::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include <chrono>
+
+#include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
+#include <QtWidgets/QApplication>
+
+#include <CkLoader/loaderspec.h>
+
+class BenchLoaderSpec : public Loader::LoaderSpec {
+public:
+    BenchLoaderSpec() {
+        single = false;
+        coreName = QStringLiteral("BenchCore");
+        pluginIID = QStringLiteral(CKBENCH_PLUGIN_IID);
+        pluginPaths = {QStringLiteral(CKBENCH_PLUGIN_DIR)};
+    }
+
+    // Keep benchmark runs independent of the user's settings
+    QSettings *createExtensionSystemSettings(QSettings::Scope scope) override {
+        return createSettings(scope, QStringLiteral("extensionsystem"));
+    }
+
+    QSettings *createChorusKitSettings(QSettings::Scope scope) override {
+        return createSettings(scope, QStringLiteral("plugins"));
+    }
+
+private:
+    static QSettings *createSettings(QSettings::Scope scope, const QString &name) {
+        QString dir = QStandardPaths::writableLocation(QStandardPaths::TempLocation) +
+                      QStringLiteral("/ckbench_startup");
+        QDir().mkpath(dir);
+        return new QSettings(QStringLiteral("%1/%2.%3.ini")
+                                 .arg(dir,
+                                      scope == QSettings::UserScope ? QStringLiteral("user")
+                                                                    : QStringLiteral("system"),
+                                      name),
+                             QSettings::IniFormat);
+    }
+};
+
+int main(int argc, char *argv[]) {
+    using namespace std::chrono;
+    auto startTime = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+
+    // Run headless unless a platform is explicitly requested
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+
+    QApplication a(argc, argv);
+    a.setApplicationName(QStringLiteral("ChorusKitStartupBenchmark"));
+    a.setProperty("ckbench.startTime", qint64(startTime));
+
+    BenchLoaderSpec spec;
+    return spec.run();
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QMap>
+#include <QtCore/QProcess>
+#include <QtCore/QTextStream>
+
+#include <benchmarkutils.h>
+
+// Spawns the startup benchmark application repeatedly and reports the distribution of the
+// metrics it prints as a `CKBENCH key=value...` line.
+
+static const char REPORT_PREFIX[] = "CKBENCH ";
+
+static bool runOnce(const QString &app, int timeout, QMap<QString, double> *result,
+                    QString *errorMessage) {
+    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("offscreen"));
+
+    QProcess process;
+    process.setProcessEnvironment(env);
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+
+    QElapsedTimer timer;
+    timer.start();
+    process.start(app, {});
+    if (!process.waitForStarted(timeout)) {
+        *errorMessage = QStringLiteral("failed to start: %1").arg(process.errorString());
+        return false;
+    }
+    if (!process.waitForFinished(timeout)) {
+        process.kill();
+        process.waitForFinished();
+        *errorMessage = QStringLiteral("timed out after %1 ms").arg(timeout);
+        return false;
+    }
+    result->insert(QStringLiteral("process_wall_ms"), double(timer.nsecsElapsed()) / 1e6);
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        *errorMessage = QStringLiteral("exited with code %1").arg(process.exitCode());
+        return false;
+    }
+
+    bool found = false;
+    const auto lines = QString::fromLocal8Bit(process.readAllStandardOutput()).split('\n');
+    for (const auto &line : lines) {
+        if (!line.startsWith(QLatin1String(REPORT_PREFIX)))
+            continue;
+        found = true;
+        const auto fields = line.mid(int(sizeof(REPORT_PREFIX)) - 1).split(' ', Qt::SkipEmptyParts);
+        for (const auto &field : fields) {
+            auto idx = field.indexOf('=');
+            if (idx > 0) {
+                result->insert(field.left(idx), field.mid(idx + 1).toDouble());
+            }
+        }
+    }
+    if (!found) {
+        *errorMessage = QStringLiteral("no report line in output");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("ChorusKit startup benchmark driver"));
+    parser.addHelpOption();
+
+    QCommandLineOption appOption(QStringLiteral("app"), QStringLiteral("Benchmark application."),
+                                 QStringLiteral("path"));
+    QCommandLineOption runsOption(QStringLiteral("runs"), QStringLiteral("Measured runs."),
+                                  QStringLiteral("count"), QStringLiteral("30"));
+    QCommandLineOption warmupOption(QStringLiteral("warmup"),
+                                    QStringLiteral("Unmeasured runs to warm up caches."),
+                                    QStringLiteral("count"), QStringLiteral("3"));
+    QCommandLineOption timeoutOption(QStringLiteral("timeout"),
+                                     QStringLiteral("Timeout of each run in milliseconds."),
+                                     QStringLiteral("ms"), QStringLiteral("60000"));
+    parser.addOptions({appOption, runsOption, warmupOption, timeoutOption});
+    parser.process(a);
+
+    QString app = parser.value(appOption);
+    if (app.isEmpty()) {
+        app = QDir(QCoreApplication::applicationDirPath()).filePath(QStringLiteral("ckbench_startup"));
+    }
+    int runs = std::max(1, parser.value(runsOption).toInt());
+    int warmup = std::max(0, parser.value(warmupOption).toInt());
+    int timeout = parser.value(timeoutOption).toInt();
+
+    QTextStream out(stdout);
+    QMap<QString, QList<double>> samples;
+    int failures = 0;
+
+    for (int i = 0; i < warmup + runs; ++i) {
+        QMap<QString, double> result;
+        QString errorMessage;
+        if (!runOnce(app, timeout, &result, &errorMessage)) {
+            out << "run " << i << ": " << errorMessage << Qt::endl;
+            failures++;
+            continue;
+        }
+        if (i < warmup)
+            continue;
+        for (auto it = result.cbegin(); it != result.cend(); ++it) {
+            samples[it.key()].append(it.value());
+        }
+    }
+
+    out << qSetFieldWidth(26) << Qt::left << "metric" << qSetFieldWidth(12) << Qt::right
+        << "median" << "p10" << "p90" << "min" << "max" << qSetFieldWidth(0) << Qt::endl;
+    for (auto it = samples.cbegin(); it != samples.cend(); ++it) {
+        const auto &values = it.value();
+        out << qSetFieldWidth(26) << Qt::left << it.key() << qSetFieldWidth(12) << Qt::right
+            << qSetRealNumberPrecision(6) << Bench::percentile(values, 0.5)
+            << Bench::percentile(values, 0.1) << Bench::percentile(values, 0.9)
+            << *std::min_element(values.begin(), values.end())
+            << *std::max_element(values.begin(), values.end()) << qSetFieldWidth(0) << Qt::endl;
+    }
+    out << "runs: " << runs << ", warmup: " << warmup << ", failures: " << failures << Qt::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+#include "benchcoreplugin.h"
+
+#include <chrono>
+#include <cstdio>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QTimer>
+#include <QtGui/QExposeEvent>
+#include <QtGui/QWindow>
+
+#ifdef Q_OS_WINDOWS
+#  include <qt_windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+#include <CoreApi/coreinterfacebase.h>
+
+namespace Bench {
+
+    // Set by the benchmark application as the first thing in main()
+    static const char START_TIME_PROPERTY[] = "ckbench.startTime";
+
+    static double elapsedMilliseconds() {
+        using namespace std::chrono;
+        auto start = qApp->property(START_TIME_PROPERTY).toLongLong();
+        auto now = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        return double(now - start) / 1e6;
+    }
+
+    static qint64 peakResidentSetSizeKiB() {
+#ifdef Q_OS_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return -1;
+        return qint64(counters.PeakWorkingSetSize / 1024);
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return -1;
+#  ifdef Q_OS_MACOS
+        return qint64(usage.ru_maxrss / 1024); // bytes on macOS
+#  else
+        return qint64(usage.ru_maxrss);
+#  endif
+#endif
+    }
+
+    BenchWindowInterface::BenchWindowInterface(QObject *parent) : WindowInterface(parent) {
+    }
+
+    BenchWindowInterface::~BenchWindowInterface() {
+    }
+
+    QWindow *BenchWindowInterface::createWindow(QObject *parent) const {
+        Q_UNUSED(parent)
+        auto win = new QWindow();
+        win->resize(800, 600);
+        return win;
+    }
+
+    BenchAddOn::BenchAddOn(QObject *parent) : WindowInterfaceAddOn(parent) {
+    }
+
+    BenchAddOn::~BenchAddOn() {
+    }
+
+    void BenchAddOn::initialize() {
+        // Register an object like real add-ons register their actions and panels
+        auto obj = new QObject(this);
+        windowHandle()->addObject(QStringLiteral("bench.addOnObjects"), obj);
+    }
+
+    void BenchAddOn::extensionsInitialized() {
+        Q_UNUSED(windowHandle()->getObjects(QStringLiteral("bench.addOnObjects")))
+    }
+
+    bool BenchAddOn::delayedInitialize() {
+        return false;
+    }
+
+    BenchCorePlugin::BenchCorePlugin()
+        : m_window(nullptr), m_windowShownTime(-1), m_initializationDoneTime(-1) {
+    }
+
+    BenchCorePlugin::~BenchCorePlugin() {
+    }
+
+    bool BenchCorePlugin::initialize(const QStringList &arguments, QString *errorMessage) {
+        Q_UNUSED(arguments)
+        Q_UNUSED(errorMessage)
+
+        new Core::CoreInterfaceBase(this);
+        return true;
+    }
+
+    void BenchCorePlugin::extensionsInitialized() {
+        Core::ExecutiveInterfaceRegistry<BenchWindowInterface> registry;
+        for (int i = 0; i < CKBENCH_ADDON_COUNT; ++i) {
+            registry.attach<BenchAddOn>();
+        }
+
+        auto iWin = registry.create();
+        connect(iWin, &Core::ExecutiveInterface::initializationDone, this, [this] {
+            m_initializationDoneTime = elapsedMilliseconds();
+            tryReport();
+        });
+
+        m_window = iWin->window();
+        m_window->installEventFilter(this);
+    }
+
+    bool BenchCorePlugin::delayedInitialize() {
+        return false;
+    }
+
+    bool BenchCorePlugin::eventFilter(QObject *obj, QEvent *event) {
+        if (obj == m_window && event->type() == QEvent::Expose && m_windowShownTime < 0 &&
+            m_window->isExposed()) {
+            m_windowShownTime = elapsedMilliseconds();
+            tryReport();
+        }
+        return IPlugin::eventFilter(obj, event);
+    }
+
+    void BenchCorePlugin::tryReport() {
+        if (m_windowShownTime < 0 || m_initializationDoneTime < 0)
+            return;
+
+        // Parsed by the driver, keep it on one line
+        std::printf("CKBENCH window_shown_ms=%.3f initialization_done_ms=%.3f peak_rss_kib=%lld\n",
+                    m_windowShownTime, m_initializationDoneTime,
+                    static_cast<long long>(peakResidentSetSizeKiB()));
+        std::fflush(stdout);
+
+        QTimer::singleShot(0, qApp, &QCoreApplication::quit);
+    }
+
+}
@@ -0,0 +1,57 @@
+#ifndef BENCHCOREPLUGIN_H
+#define BENCHCOREPLUGIN_H
+
+#include <extensionsystem/iplugin.h>
+
+#include <CoreApi/windowinterface.h>
+
+namespace Bench {
+
+    class BenchWindowInterface : public Core::WindowInterface {
+        Q_OBJECT
+    public:
+        explicit BenchWindowInterface(QObject *parent = nullptr);
+        ~BenchWindowInterface();
+
+    protected:
+        QWindow *createWindow(QObject *parent) const override;
+
+        friend class Core::ExecutiveInterfaceRegistry<BenchWindowInterface>;
+    };
+
+    class BenchAddOn : public Core::WindowInterfaceAddOn {
+        Q_OBJECT
+    public:
+        explicit BenchAddOn(QObject *parent = nullptr);
+        ~BenchAddOn();
+
+        void initialize() override;
+        void extensionsInitialized() override;
+        bool delayedInitialize() override;
+    };
+
+    class BenchCorePlugin : public ExtensionSystem::IPlugin {
+        Q_OBJECT
+        Q_PLUGIN_METADATA(IID "org.ChorusKit.Benchmark.Plugin" FILE "plugin.json")
+    public:
+        BenchCorePlugin();
+        ~BenchCorePlugin();
+
+        bool initialize(const QStringList &arguments, QString *errorMessage) override;
+        void extensionsInitialized() override;
+        bool delayedInitialize() override;
+
+    protected:
+        bool eventFilter(QObject *obj, QEvent *event) override;
+
+    private:
+        void tryReport();
+
+        QWindow *m_window;
+        double m_windowShownTime;
+        double m_initializationDoneTime;
+    };
+
+}
+
+#endif // BENCHCOREPLUGIN_H
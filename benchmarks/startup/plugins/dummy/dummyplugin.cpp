@@ -0,0 +1,24 @@
+#include "dummyplugin.h"
+
+namespace Bench {
+
+    DummyPlugin::DummyPlugin() {
+    }
+
+    DummyPlugin::~DummyPlugin() {
+    }
+
+    bool DummyPlugin::initialize(const QStringList &arguments, QString *errorMessage) {
+        Q_UNUSED(arguments)
+        Q_UNUSED(errorMessage)
+        return true;
+    }
+
+    void DummyPlugin::extensionsInitialized() {
+    }
+
+    bool DummyPlugin::delayedInitialize() {
+        return false;
+    }
+
+}
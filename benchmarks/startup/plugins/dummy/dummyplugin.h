@@ -0,0 +1,22 @@
+#ifndef DUMMYPLUGIN_H
+#define DUMMYPLUGIN_H
+
+#include <extensionsystem/iplugin.h>
+
+namespace Bench {
+
+    class DummyPlugin : public ExtensionSystem::IPlugin {
+        Q_OBJECT
+        Q_PLUGIN_METADATA(IID "org.ChorusKit.Benchmark.Plugin" FILE "plugin.json")
+    public:
+        DummyPlugin();
+        ~DummyPlugin();
+
+        bool initialize(const QStringList &arguments, QString *errorMessage) override;
+        void extensionsInitialized() override;
+        bool delayedInitialize() override;
+    };
+
+}
+
+#endif // DUMMYPLUGIN_H
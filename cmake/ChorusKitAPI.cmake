@@ -36,6 +36,10 @@ endif()
         CK_WIN_APPLOCAL_DEPS
         CK_SYNC_INCLUDE_FORCE
 
+        CK_LTO (override LTO of ck_configure_application)
+        CK_PGO (override PGO of ck_configure_application)
+        CK_PGO_PROFILE_DIR (override PGO_PROFILE_DIR of ck_configure_application)
+
 ]] #
 macro(ck_init_buildsystem)
     # Check platform, only Windows/Macintosh/Linux is supported
@@ -216,6 +220,8 @@ macro(ck_init_buildsystem)
     # Used ChorusKit Metadata Keys:
     # APPLICATION_PLUGINS
     # APPLICATION_LIBRARIES
+    # PLAIN_EXECUTABLES
+    # STATIC_PLUGINS
 endmacro()
 
 #[[
@@ -230,6 +236,9 @@ macro(ck_finish_buildsystem)
     qm_generate_config(${_ck_config_file})
     qm_generate_build_info(${_ck_buildinfo_file} YEAR TIME PREFIX ${CK_BUILDINFO_PREFIX})
 
+    _ck_generate_static_plugin_imports()
+    _ck_apply_build_profile()
+
     if(CK_ENABLE_INSTALL AND CK_ENABLE_DEVEL)
         if(EXISTS ${_ck_config_file})
             install(FILES ${_ck_config_file}
@@ -248,22 +257,86 @@ endmacro()
 
         [WIN_SHORTCUT]
         [SKIP_EXPORT]
+
+        [STATIC_PLUGINS plugins...]
+
+        [LTO OFF | THIN | FULL]
+        [PGO OFF | GENERATE | USE]
+        [PGO_PROFILE_DIR dir]
+        [PGO_TRAINING_COMMAND command...]
     )
 
     ICO:  set Windows icon file
     ICNS: set Mac icon file
 
     WIN_SHORTCUT: create shortcut after build
+
+    STATIC_PLUGINS: plugin targets to link statically into the application instead of building
+                    them as shared libraries, they must be added by `ck_add_plugin` with the
+                    PLUGIN_CLASS argument afterwards, every plugin or shared library linking a
+                    static plugin must be static as well, otherwise it embeds its own copy
+
+    LTO: link time optimization of the application, plugins, libraries and executables,
+         THIN falls back to FULL on compilers other than Clang, Clang links with lld if the
+         default linker cannot link bitcode, and LTO is disabled with a warning otherwise
+    PGO: profile guided optimization stage, build with GENERATE and run the
+         `ChorusKit_PGOTraining` target, then reconfigure with USE in the same profile directory,
+         the training removes the raw profiles of earlier runs first
+    PGO_PROFILE_DIR: set the directory of profile data, default to `${CMAKE_BINARY_DIR}/pgo`
+    PGO_TRAINING_COMMAND: set the training scenario run by `ChorusKit_PGOTraining`,
+                          such as the startup benchmark
+
+    The LTO and PGO options are applied by `ck_finish_buildsystem`, and can be overridden by the
+    CK_LTO, CK_PGO and CK_PGO_PROFILE_DIR variables for the two PGO stages.
 ]] #
 function(ck_configure_application)
     set(options WIN_SHORTCUT)
-    set(oneValueArgs ICNS INFO_PLIST)
-    set(multiValueArgs ICO)
+    set(oneValueArgs ICNS INFO_PLIST LTO PGO PGO_PROFILE_DIR)
+    set(multiValueArgs ICO STATIC_PLUGINS PGO_TRAINING_COMMAND)
     cmake_parse_arguments(FUNC "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
     set(_target ${CK_APPLICATION_TARGET})
     add_executable(${_target})
 
+    # Plugins bundled into the application, consumed by `ck_add_plugin`
+    set_property(TARGET ChorusKit_Metadata PROPERTY STATIC_PLUGINS ${FUNC_STATIC_PLUGINS})
+
+    # Build profile, applied by `ck_finish_buildsystem`
+    foreach(_key LTO PGO PGO_PROFILE_DIR)
+        if(DEFINED CK_${_key})
+            set(_value ${CK_${_key}})
+        elseif(DEFINED FUNC_${_key})
+            set(_value ${FUNC_${_key}})
+        elseif(_key STREQUAL "PGO_PROFILE_DIR")
+            set(_value ${CMAKE_BINARY_DIR}/pgo)
+        else()
+            set(_value OFF)
+        endif()
+
+        string(TOLOWER ${_key} _var)
+        set(_${_var} ${_value})
+    endforeach()
+
+    string(TOUPPER ${_lto} _lto)
+    string(TOUPPER ${_pgo} _pgo)
+
+    if(NOT _lto MATCHES "^(OFF|THIN|FULL)$")
+        message(FATAL_ERROR "ck_configure_application: invalid LTO value ${_lto}")
+    endif()
+
+    if(NOT _pgo MATCHES "^(OFF|GENERATE|USE)$")
+        message(FATAL_ERROR "ck_configure_application: invalid PGO value ${_pgo}")
+    endif()
+
+    get_filename_component(_pgo_dir ${_pgo_profile_dir} ABSOLUTE BASE_DIR ${CMAKE_BINARY_DIR})
+
+    set_target_properties(ChorusKit_Metadata PROPERTIES
+        BUILD_LTO ${_lto}
+        BUILD_PGO ${_pgo}
+        BUILD_PGO_PROFILE_DIR ${_pgo_dir}
+    )
+    set_property(TARGET ChorusKit_Metadata PROPERTY BUILD_PGO_TRAINING_COMMAND ${FUNC_PGO_TRAINING_COMMAND})
+
     # Make location dependent executable, otherwise GNOME cannot recognize
     if(LINUX)
         target_link_options(${_target} PRIVATE "-no-pie")
@@ -397,18 +470,39 @@ endfunction()
         [MACRO_PREFIX   prefix]
         [STATIC_MACRO   macro]
         [LIBRARY_MACRO  macro]
+        [PLUGIN_CLASS   class]
     )
 
     NO_PLUGIN_JSON: skip configuring the plugin.json.in
     CATEGORY: set the sub-directory name for plugin to output, which is same as `PROJECT_NAME` by default
     PLUGIN_JSON: set the custom plugin.json.in file to configure, otherwise configure the plugin.json.in in currect directory
+    PLUGIN_CLASS: set the plugin class name (without namespace) declaring `Q_PLUGIN_METADATA`,
+                  required if the plugin is listed in STATIC_PLUGINS of `ck_configure_application`
 ]] #
 function(ck_add_plugin _target)
     set(options SKIP_EXPORT)
-    set(oneValueArgs COPYRIGHT VENDOR PLUGIN_JSON)
+    set(oneValueArgs COPYRIGHT VENDOR PLUGIN_JSON PLUGIN_CLASS)
     set(multiValueArgs)
     cmake_parse_arguments(FUNC "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
 
+    # The application decides which plugins are bundled
+    if(NOT TARGET ${CK_APPLICATION_TARGET})
+        message(FATAL_ERROR "ck_add_plugin: ck_configure_application must be called before adding plugin ${_target}")
+    endif()
+
+    # Check if the plugin is bundled into the application
+    get_property(_static_plugins TARGET ChorusKit_Metadata PROPERTY STATIC_PLUGINS)
+
+    if(_target IN_LIST _static_plugins)
+        set(_static on)
+
+        if(NOT FUNC_PLUGIN_CLASS)
+            message(FATAL_ERROR "ck_add_plugin: static plugin ${_target} requires PLUGIN_CLASS")
+        endif()
+    else()
+        set(_static off)
+    endif()
+
     # Add Qt Moc
     _ck_set_cmake_autoxxx(on)
 
@@ -420,20 +514,32 @@ function(ck_add_plugin _target)
         set(VCPKG_APPLOCAL_DEPS off) # Temporarily disable VCPKG_APPLOCAL_DEPS
     endif()
 
-    _ck_add_library_internal(${_target} SHARED ${FUNC_UNPARSED_ARGUMENTS})
+    if(_static)
+        _ck_add_library_internal(${_target} ${FUNC_UNPARSED_ARGUMENTS})
+    else()
+        _ck_add_library_internal(${_target} SHARED ${FUNC_UNPARSED_ARGUMENTS})
+    endif()
+
     add_library(${CK_APPLICATION_TARGET}::${_target} ALIAS ${_target})
 
     if(_vcpkg_applocal_deps)
         set(VCPKG_APPLOCAL_DEPS on)
     endif()
 
-    # Add target level dependency
-    add_dependencies(${CK_APPLICATION_TARGET} ${_target})
+    if(_static)
+        # Metadata is embedded at compile time and imported by `ck_finish_buildsystem`
+        target_compile_definitions(${_target} PRIVATE QT_STATICPLUGIN)
+        set_target_properties(${_target} PROPERTIES CK_PLUGIN_CLASS ${FUNC_PLUGIN_CLASS})
+        target_link_libraries(${CK_APPLICATION_TARGET} PRIVATE ${_target})
+    else()
+        # Add target level dependency
+        add_dependencies(${CK_APPLICATION_TARGET} ${_target})
+    endif()
 
     qm_set_value(_vendor FUNC_VENDOR ${CK_APPLICATION_VENDOR})
     qm_set_value(_copyright FUNC_COPYRIGHT "Copyright ${CK_DEV_START_YEAR}-${CK_CURRENT_YEAR} ${_vendor}")
 
-    if(WIN32)
+    if(WIN32 AND NOT _static)
         # Add windows rc file
         qm_add_win_rc(${_target}
             COPYRIGHT "${_copyright}"
@@ -473,7 +579,8 @@ function(ck_add_plugin _target)
         ARCHIVE_OUTPUT_DIRECTORY ${_build_output_dir}
     )
 
-    if(CK_ENABLE_INSTALL)
+    # Static plugins live in the application binary, only the attached files are installed
+    if(CK_ENABLE_INSTALL AND NOT _static)
         # Install target
         if(FUNC_SKIP_EXPORT)
             set(_export)
@@ -985,6 +1092,227 @@ function(_ck_try_set_output_name _target _name)
     endif()
 endfunction()
 
+function(_ck_generate_static_plugin_imports)
+    get_property(_static_plugins TARGET ChorusKit_Metadata PROPERTY STATIC_PLUGINS)
+
+    if(NOT _static_plugins)
+        return()
+    endif()
+
+    set(_content "// Generated by ChorusKitAPI, do not edit\n\n#include <QtCore/QtPlugin>\n\n")
+
+    foreach(_plugin IN LISTS _static_plugins)
+        if(NOT TARGET ${_plugin})
+            message(FATAL_ERROR "ck_finish_buildsystem: static plugin ${_plugin} is not added by ck_add_plugin")
+        endif()
+
+        get_target_property(_class ${_plugin} CK_PLUGIN_CLASS)
+        set(_content "${_content}Q_IMPORT_PLUGIN(${_class})\n")
+    endforeach()
+
+    # A shared target linking a static plugin would hold a second copy of its code and data
+    get_property(_plugins TARGET ChorusKit_Metadata PROPERTY APPLICATION_PLUGINS)
+    get_property(_libraries TARGET ChorusKit_Metadata PROPERTY APPLICATION_LIBRARIES)
+
+    foreach(_item IN LISTS _plugins _libraries)
+        set(_shared)
+        _ck_check_shared_library(${_item} _shared)
+
+        if(NOT _shared)
+            continue()
+        endif()
+
+        get_target_property(_links ${_item} LINK_LIBRARIES)
+
+        if(NOT _links)
+            continue()
+        endif()
+
+        foreach(_plugin IN LISTS _static_plugins)
+            set(_alias ${CK_APPLICATION_TARGET}::${_plugin})
+
+            if(_plugin IN_LIST _links OR _alias IN_LIST _links)
+                message(FATAL_ERROR "ck_finish_buildsystem: shared target ${_item} links static plugin ${_plugin}, add ${_item} to STATIC_PLUGINS as well")
+            endif()
+        endforeach()
+    endforeach()
+
+    set(_file ${CMAKE_CURRENT_BINARY_DIR}/${CK_APPLICATION_TARGET}_static_plugins.cpp)
+    file(GENERATE OUTPUT ${_file} CONTENT "${_content}")
+    target_sources(${CK_APPLICATION_TARGET} PRIVATE ${_file})
+endfunction()
+
+function(_ck_apply_build_profile)
+    get_target_property(_lto ChorusKit_Metadata BUILD_LTO)
+    get_target_property(_pgo ChorusKit_Metadata BUILD_PGO)
+    get_target_property(_pgo_dir ChorusKit_Metadata BUILD_PGO_PROFILE_DIR)
+
+    if((NOT _lto OR _lto STREQUAL "OFF") AND(NOT _pgo OR _pgo STREQUAL "OFF"))
+        return()
+    endif()
+
+    # Collect all targets created by ChorusKitAPI
+    get_property(_plugins TARGET ChorusKit_Metadata PROPERTY APPLICATION_PLUGINS)
+    get_property(_libraries TARGET ChorusKit_Metadata PROPERTY APPLICATION_LIBRARIES)
+    get_property(_executables TARGET ChorusKit_Metadata PROPERTY PLAIN_EXECUTABLES)
+    set(_targets ${CK_APPLICATION_TARGET} ${_plugins} ${_libraries} ${_executables})
+
+    # Build ChorusKit itself with the same profile if it's in the source tree
+    if(TARGET CkAppCore)
+        get_target_property(_imported CkAppCore IMPORTED)
+
+        if(NOT _imported)
+            list(APPEND _targets CkAppCore)
+        endif()
+    endif()
+
+    set(_compiler ${CMAKE_CXX_COMPILER_ID})
+    set(_compile_options)
+    set(_link_options)
+    set(_ipo off)
+
+    # Link time optimization
+    if(NOT _lto STREQUAL "OFF" AND _compiler MATCHES "Clang")
+        string(TOLOWER ${_lto} _lto_mode)
+
+        # GNU ld can only link bitcode with the LLVMgold plugin, fall back to lld
+        include(CheckCXXSourceCompiles)
+        set(CMAKE_REQUIRED_QUIET on)
+        set(CMAKE_REQUIRED_FLAGS -flto=${_lto_mode})
+        set(CMAKE_REQUIRED_LINK_OPTIONS -flto=${_lto_mode})
+        check_cxx_source_compiles("int main() { return 0; }" CK_LTO_${_lto}_LINKS)
+        set(_lto_link_options -flto=${_lto_mode})
+
+        if(NOT CK_LTO_${_lto}_LINKS)
+            set(CMAKE_REQUIRED_LINK_OPTIONS -flto=${_lto_mode} -fuse-ld=lld)
+            check_cxx_source_compiles("int main() { return 0; }" CK_LTO_${_lto}_LINKS_LLD)
+            set(_lto_link_options -flto=${_lto_mode} -fuse-ld=lld)
+        endif()
+
+        if(CK_LTO_${_lto}_LINKS OR CK_LTO_${_lto}_LINKS_LLD)
+            list(APPEND _compile_options -flto=${_lto_mode})
+            list(APPEND _link_options ${_lto_link_options})
+        else()
+            message(WARNING "ck_finish_buildsystem: the linker cannot link -flto=${_lto_mode} objects and lld is not available, LTO is disabled")
+        endif()
+    elseif(_lto STREQUAL "THIN" OR _lto STREQUAL "FULL")
+        set(_ipo on)
+    endif()
+
+    # Profile guided optimization
+    if(_pgo STREQUAL "GENERATE")
+        file(MAKE_DIRECTORY ${_pgo_dir})
+
+        if(_compiler MATCHES "Clang")
+            list(APPEND _compile_options -fprofile-generate=${_pgo_dir})
+            list(APPEND _link_options -fprofile-generate=${_pgo_dir})
+        elseif(_compiler STREQUAL "GNU")
+            list(APPEND _compile_options -fprofile-generate=${_pgo_dir} -fprofile-update=atomic)
+            list(APPEND _link_options -fprofile-generate=${_pgo_dir})
+        elseif(MSVC)
+            set(_ipo on) # MSVC requires /GL for profiling
+        endif()
+    elseif(_pgo STREQUAL "USE")
+        if(_compiler MATCHES "Clang")
+            set(_profdata ${_pgo_dir}/default.profdata)
+
+            if(NOT EXISTS ${_profdata})
+                message(WARNING "ck_finish_buildsystem: ${_profdata} not found, run ChorusKit_PGOTraining first")
+            endif()
+
+            list(APPEND _compile_options -fprofile-use=${_profdata}
+                -Wno-profile-instr-out-of-date -Wno-profile-instr-unprofiled)
+            list(APPEND _link_options -fprofile-use=${_profdata})
+        elseif(_compiler STREQUAL "GNU")
+            list(APPEND _compile_options -fprofile-use=${_pgo_dir} -fprofile-correction -Wno-missing-profile)
+            list(APPEND _link_options -fprofile-use=${_pgo_dir})
+        elseif(MSVC)
+            set(_ipo on)
+        endif()
+    endif()
+
+    if(_ipo)
+        include(CheckIPOSupported)
+        check_ipo_supported(RESULT _ipo_supported OUTPUT _ipo_output LANGUAGES CXX)
+
+        if(NOT _ipo_supported)
+            message(WARNING "ck_finish_buildsystem: LTO is not supported: ${_ipo_output}")
+            set(_ipo off)
+        endif()
+    endif()
+
+    foreach(_target IN LISTS _targets)
+        get_target_property(_type ${_target} TYPE)
+
+        if(_type STREQUAL "INTERFACE_LIBRARY" OR _type STREQUAL "UTILITY")
+            continue()
+        endif()
+
+        target_compile_options(${_target} PRIVATE ${_compile_options})
+
+        if(_ipo)
+            set_target_properties(${_target} PROPERTIES INTERPROCEDURAL_OPTIMIZATION ON)
+        endif()
+
+        if(_type STREQUAL "STATIC_LIBRARY")
+            continue()
+        endif()
+
+        target_link_options(${_target} PRIVATE ${_link_options})
+
+        # MSVC keeps one profile database per binary
+        if(MSVC AND NOT _pgo STREQUAL "OFF")
+            if(_pgo STREQUAL "GENERATE")
+                target_link_options(${_target} PRIVATE /GENPROFILE:PGD=${_pgo_dir}/${_target}.pgd)
+            else()
+                target_link_options(${_target} PRIVATE /USEPROFILE:PGD=${_pgo_dir}/${_target}.pgd)
+            endif()
+        endif()
+    endforeach()
+
+    # Training scenario of the first stage
+    get_property(_training_command TARGET ChorusKit_Metadata PROPERTY BUILD_PGO_TRAINING_COMMAND)
+
+    if(_pgo STREQUAL "GENERATE" AND _training_command)
+        # Counters of earlier runs would be merged into the profile otherwise
+        set(_clean_script ${CMAKE_BINARY_DIR}/ChorusKitPGOClean.cmake)
+        file(WRITE ${_clean_script}
+            "file(GLOB_RECURSE _stale \"${_pgo_dir}/*.profraw\" \"${_pgo_dir}/*.gcda\" \"${_pgo_dir}/*.pgc\")\n"
+            "if(_stale)\n    file(REMOVE \${_stale})\nendif()\n"
+        )
+        set(_commands
+            COMMAND ${CMAKE_COMMAND} -P ${_clean_script}
+            COMMAND ${_training_command}
+        )
+
+        if(_compiler MATCHES "Clang")
+            get_filename_component(_compiler_dir ${CMAKE_CXX_COMPILER} DIRECTORY)
+            find_program(CK_LLVM_PROFDATA llvm-profdata HINTS ${_compiler_dir})
+
+            if(NOT CK_LLVM_PROFDATA)
+                message(FATAL_ERROR "ck_finish_buildsystem: llvm-profdata is required to merge profiles")
+            endif()
+
+            # Merge raw profiles for the second stage
+            set(_merge_script ${CMAKE_BINARY_DIR}/ChorusKitPGOMerge.cmake)
+            file(WRITE ${_merge_script}
+                "file(GLOB _raw \"${_pgo_dir}/*.profraw\")\n"
+                "execute_process(COMMAND \"${CK_LLVM_PROFDATA}\" merge \"-output=${_pgo_dir}/default.profdata\" \${_raw} RESULT_VARIABLE _res)\n"
+                "if(_res)\n    message(FATAL_ERROR \"llvm-profdata merge failed\")\nendif()\n"
+            )
+            list(APPEND _commands COMMAND ${CMAKE_COMMAND} -P ${_merge_script})
+        endif()
+
+        add_custom_target(ChorusKit_PGOTraining
+            ${_commands}
+            WORKING_DIRECTORY ${CK_BUILD_MAIN_DIR}
+            COMMENT "Running PGO training scenario"
+            USES_TERMINAL
+        )
+        add_dependencies(ChorusKit_PGOTraining ${CK_APPLICATION_TARGET})
+    endif()
+endfunction()
+
 function(_ck_configure_plugin_desc _file)
     set(options ALL_FILES ALL_SUBDIRS)
     set(oneValueArgs NAME)
@@ -0,0 +1,165 @@
+// The MIT License (MIT)
+//
+// Copyright (c) ChorusKit contributors 2026
+//
+// Written for the ChorusKit copy of SingleApplication, not part of the upstream project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+//  W A R N I N G !!!
+//  -----------------
+//
+// This file is not part of the SingleApplication API. It is used purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or may even be removed.
+//
+
+#include <cstring>
+
+#include "crc32c_p.h"
+
+#if defined(Q_PROCESSOR_X86_64) &&                                                               \
+    (defined(Q_CC_GNU) || defined(Q_CC_CLANG) || defined(Q_CC_MSVC))
+#define SINGLEAPPLICATION_CRC32C_SSE42
+#include <nmmintrin.h>
+#ifdef Q_CC_MSVC
+#include <intrin.h>
+#endif
+#elif defined(Q_PROCESSOR_ARM_64) && defined(__ARM_FEATURE_CRC32)
+#define SINGLEAPPLICATION_CRC32C_ARM
+#include <arm_acle.h>
+#endif
+
+namespace {
+
+    using Crc32cFunction = quint32 (*)(quint32, const char *, qsizetype);
+
+    // Reflected polynomial of CRC32C
+    constexpr quint32 Crc32cPolynomial = 0x82f63b78;
+
+    struct Crc32cTables {
+        quint32 table[8][256];
+
+        Crc32cTables() {
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 crc = i;
+                for (int j = 0; j < 8; ++j)
+                    crc = (crc >> 1) ^ ((crc & 1) ? Crc32cPolynomial : 0);
+                table[0][i] = crc;
+            }
+            for (quint32 i = 0; i < 256; ++i) {
+                for (int k = 1; k < 8; ++k)
+                    table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+            }
+        }
+    };
+
+    // Slicing-by-8, processes eight bytes per iteration
+    quint32 crc32cPortable(quint32 crc, const char *data, qsizetype size) {
+        static const Crc32cTables tables;
+        const auto &t = tables.table;
+
+        const auto *p = reinterpret_cast<const uchar *>(data);
+        while (size > 0 && (reinterpret_cast<quintptr>(p) & 7) != 0) {
+            crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+            --size;
+        }
+        while (size >= 8) {
+            quint32 lo, hi;
+            memcpy(&lo, p, sizeof(lo));
+            memcpy(&hi, p + 4, sizeof(hi));
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+            lo = qbswap(lo);
+            hi = qbswap(hi);
+#endif
+            lo ^= crc;
+            crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^
+                  t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^
+                  t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+            p += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+            crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+        return crc;
+    }
+
+#if defined(SINGLEAPPLICATION_CRC32C_SSE42)
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+    __attribute__((target("sse4.2")))
+#endif
+    quint32 crc32cHardware(quint32 crc, const char *data, qsizetype size) {
+        quint64 crc64 = crc;
+        while (size >= 8) {
+            quint64 value;
+            memcpy(&value, data, sizeof(value));
+            crc64 = _mm_crc32_u64(crc64, value);
+            data += 8;
+            size -= 8;
+        }
+        crc = static_cast<quint32>(crc64);
+        while (size-- > 0)
+            crc = _mm_crc32_u8(crc, static_cast<uchar>(*data++));
+        return crc;
+    }
+
+    bool hasHardwareCrc32c() {
+#if defined(Q_CC_MSVC)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#else
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    }
+#elif defined(SINGLEAPPLICATION_CRC32C_ARM)
+    quint32 crc32cHardware(quint32 crc, const char *data, qsizetype size) {
+        while (size >= 8) {
+            quint64 value;
+            memcpy(&value, data, sizeof(value));
+            crc = __crc32cd(crc, value);
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0)
+            crc = __crc32cb(crc, static_cast<uchar>(*data++));
+        return crc;
+    }
+
+    bool hasHardwareCrc32c() {
+        // The instructions are available at compile time
+        return true;
+    }
+#endif
+
+    Crc32cFunction selectCrc32c() {
+#if defined(SINGLEAPPLICATION_CRC32C_SSE42) || defined(SINGLEAPPLICATION_CRC32C_ARM)
+        if (hasHardwareCrc32c())
+            return crc32cHardware;
+#endif
+        return crc32cPortable;
+    }
+
+}
+
+quint32 singleApplicationCrc32c(const char *data, qsizetype size, quint32 crc) {
+    static const Crc32cFunction func = selectCrc32c();
+    return ~func(~crc, data, size);
+}
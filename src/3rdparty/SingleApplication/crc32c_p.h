@@ -0,0 +1,46 @@
+// The MIT License (MIT)
+//
+// Copyright (c) ChorusKit contributors 2026
+//
+// Written for the ChorusKit copy of SingleApplication, not part of the upstream project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+//  W A R N I N G !!!
+//  -----------------
+//
+// This file is not part of the SingleApplication API. It is used purely as an
+// implementation detail. This header file may change from version to
+// version without notice, or may even be removed.
+//
+
+#ifndef SINGLEAPPLICATION_CRC32C_P_H
+#define SINGLEAPPLICATION_CRC32C_P_H
+
+#include <QtCore/QtGlobal>
+
+/**
+ * @brief Computes the CRC32C (Castagnoli) checksum of the data
+ * @note Uses the SSE4.2 or ARMv8 CRC32 instructions if the CPU supports them and falls back
+ * to a table driven implementation otherwise. The implementation is selected once.
+ */
+quint32 singleApplicationCrc32c(const char *data, qsizetype size, quint32 crc = 0);
+
+#endif // SINGLEAPPLICATION_CRC32C_P_H
@@ -60,10 +60,6 @@ SingleApplication::SingleApplication(QObject *parent, bool allowSecondary, Optio
     // block and QLocalServer
     d->genBlockServerName();
 
-    // To mitigate QSharedMemory issues with large amount of processes
-    // attempting to attach at the same time
-    SingleApplicationPrivate::randomSleep();
-
 #ifdef Q_OS_UNIX
     // By explicitly attaching it and then deleting it we make sure that the
     // memory is deleted even after the process has crashed on Unix.
@@ -100,13 +96,28 @@ SingleApplication::SingleApplication(QObject *parent, bool allowSecondary, Optio
     }
 
     auto *inst = static_cast<InstancesInfo *>(d->memory->data());
+
+    // An instance of another protocol version can neither receive our messages nor hand its
+    // block over, so refuse to start instead of becoming a second primary instance
+    const bool olderBlock = static_cast<size_t>(d->memory->size()) < sizeof(InstancesInfo);
+    if (olderBlock ||
+        (inst->version != 0 && inst->version != SingleApplicationPrivate::ProtocolVersion)) {
+        qCritical() << "SingleApplication: Another instance uses protocol version"
+                    << (olderBlock ? 1 : inst->version) << "instead of"
+                    << SingleApplicationPrivate::ProtocolVersion;
+        d->memory->unlock();
+        delete d;
+        ::exit(EXIT_FAILURE);
+    }
+
     QElapsedTimer time;
     time.start();
 
     // Make sure the shared memory block is initialised and in consistent state
-    while (true) {
+    for (int attempt = 1;; ++attempt) {
         // If the shared memory block's checksum is valid continue
-        if (d->blockChecksum() == inst->checksum)
+        if (inst->version == SingleApplicationPrivate::ProtocolVersion &&
+            d->blockChecksum() == inst->checksum)
             break;
 
         // If more than 5s have elapsed, assume the primary instance crashed and
@@ -117,16 +128,16 @@ SingleApplication::SingleApplication(QObject *parent, bool allowSecondary, Optio
             d->initializeMemoryBlock();
         }
 
-        // Otherwise wait for a random period and try again. The random sleep here
-        // limits the probability of a collision between two racing apps and
-        // allows the app to initialise faster
+        // Otherwise let the instance that created the block initialise it. Writers
+        // update the block while holding the lock, so this only spins briefly after
+        // a creation or a crash
         if (!d->memory->unlock()) {
-            qDebug() << "SingleApplication: Unable to unlock memory for random wait.";
+            qDebug() << "SingleApplication: Unable to unlock memory for wait.";
             qDebug() << d->memory->errorString();
         }
-        SingleApplicationPrivate::randomSleep();
+        SingleApplicationPrivate::backoffSleep(attempt);
         if (!d->memory->lock()) {
-            qCritical() << "SingleApplication: Unable to lock memory after random wait.";
+            qCritical() << "SingleApplication: Unable to lock memory after wait.";
             abortSafely();
         }
     }
@@ -144,7 +155,8 @@ SingleApplication::SingleApplication(QObject *parent, bool allowSecondary, Optio
     if (allowSecondary) {
         d->startSecondary();
         if (d->options & Mode::SecondaryNotification) {
-            d->connectToPrimary(timeout, SingleApplicationPrivate::SecondaryInstance);
+            if (d->connectToPrimary(timeout, SingleApplicationPrivate::SecondaryInstance))
+                d->waitForAcks(timeout);
         }
         if (!d->memory->unlock()) {
             qDebug() << "SingleApplication: Unable to unlock memory after secondary start.";
@@ -158,7 +170,8 @@ SingleApplication::SingleApplication(QObject *parent, bool allowSecondary, Optio
         qDebug() << d->memory->errorString();
     }
 
-    d->connectToPrimary(timeout, SingleApplicationPrivate::NewInstance);
+    if (d->connectToPrimary(timeout, SingleApplicationPrivate::NewInstance))
+        d->waitForAcks(timeout);
 
     delete d;
 
@@ -241,11 +254,52 @@ bool SingleApplication::sendMessage(const QByteArray &message, int timeout, Send
     if (isPrimary())
         return false;
 
-    // Make sure the socket is connected
+    d->messageQueue.append(message);
+    return flushMessages(timeout, sendMode);
+}
+
+/**
+ * Queues a message for the Primary Instance without sending it.
+ * @param message The message to send.
+ */
+void SingleApplication::queueMessage(const QByteArray &message) {
+    Q_D(SingleApplication);
+    d->messageQueue.append(message);
+}
+
+/**
+ * Sends all queued messages to the Primary Instance in a single write and
+ * waits for the acknowledgement of the last one. Messages that are not
+ * acknowledged in time stay queued for the next call.
+ * @param timeout the maximum timeout in milliseconds for blocking functions.
+ * @param sendMode mode of operation
+ * @return true if the messages were sent successfuly, false otherwise.
+ */
+bool SingleApplication::flushMessages(int timeout, SendMode sendMode) {
+    Q_D(SingleApplication);
+
+    // Nobody to connect to
+    if (isPrimary())
+        return false;
+
+    // Make sure the socket is connected, the init message shares the round trip
+    // with the queued messages if a new connection is made
     if (!d->connectToPrimary(timeout, SingleApplicationPrivate::Reconnect))
         return false;
 
-    return d->writeConfirmedMessage(timeout, message, sendMode);
+    // Messages already written on this connection are on their way, only wait for their ack
+    const qint64 firstFrame = qint64(d->framesSent) - d->messagesWritten;
+    const QList<QByteArray> msgs = d->messageQueue.mid(d->messagesWritten);
+    const bool result = d->writeConfirmedMessages(timeout, msgs, sendMode);
+
+    // Drop the acknowledged messages only, the others are written again if the connection is
+    // lost before the next flush
+    d->messagesWritten = d->messageQueue.size();
+    const qsizetype acked = qBound<qint64>(0, qint64(d->framesAcked) - firstFrame,
+                                           d->messagesWritten);
+    d->messageQueue.remove(0, acked);
+    d->messagesWritten -= acked;
+    return result;
 }
 
 /**
@@ -150,6 +150,26 @@ public:
      */
     bool sendMessage(const QByteArray &message, int timeout = 100, SendMode sendMode = NonBlocking);
 
+    /**
+     * @brief Queues a message to be sent to the primary instance by the next
+     * flushMessages() or sendMessage() call
+     * @param message data to send
+     * @note Queued messages are written together and acknowledged at once, which
+     * saves a round trip per message
+     */
+    void queueMessage(const QByteArray &message);
+
+    /**
+     * @brief Sends all queued messages to the primary instance
+     * @param timeout timeout for connecting and for the acknowledgement
+     * @param sendMode - Mode of operation
+     * @returns `true` on success
+     * @note flushMessages() will return false if invoked from the primary instance
+     * @note Messages that are not acknowledged in time stay queued, calling it again waits for
+     * them without writing them twice on the same connection
+     */
+    bool flushMessages(int timeout = 100, SendMode sendMode = NonBlocking);
+
     /**
      * @brief Get the set user data.
      * @returns user data
@@ -31,22 +31,20 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 
 #include <QtCore/QByteArray>
 #include <QtCore/QCryptographicHash>
 #include <QtCore/QDataStream>
+#include <QtCore/QDebug>
 #include <QtCore/QDir>
 #include <QtCore/QElapsedTimer>
 #include <QtCore/QThread>
+#include <QtCore/QtEndian>
 #include <QtNetwork/QLocalServer>
 #include <QtNetwork/QLocalSocket>
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
-#include <QtCore/QRandomGenerator>
-#else
-#include <QtCore/QDateTime>
-#endif
-
+#include "crc32c_p.h"
 #include "singleapplication.h"
 #include "singleapplication_p.h"
 
@@ -64,11 +62,18 @@
 #include <windows.h>
 #endif
 
+SingleApplicationPrivate::ChecksumFunction SingleApplicationPrivate::checksumFunction =
+    singleApplicationCrc32c;
+
 SingleApplicationPrivate::SingleApplicationPrivate(SingleApplication *q_ptr) : q_ptr(q_ptr) {
     server = nullptr;
     socket = nullptr;
     memory = nullptr;
     instanceNumber = 0;
+    framesSent = 0;
+    framesAcked = 0;
+    messagesWritten = 0;
+    sharedPayloadCount = 0;
 }
 
 SingleApplicationPrivate::~SingleApplicationPrivate() {
@@ -77,6 +82,8 @@ SingleApplicationPrivate::~SingleApplicationPrivate() {
         delete socket;
     }
 
+    releaseSharedPayloads();
+
     if (memory != nullptr) {
         memory->lock();
         auto *inst = static_cast<InstancesInfo *>(memory->data());
@@ -171,6 +178,7 @@ void SingleApplicationPrivate::genBlockServerName() {
 
 void SingleApplicationPrivate::initializeMemoryBlock() const {
     auto *inst = static_cast<InstancesInfo *>(memory->data());
+    inst->version = ProtocolVersion;
     inst->primary = false;
     inst->secondary = 0;
     inst->primaryPid = -1;
@@ -227,8 +235,11 @@ bool SingleApplicationPrivate::connectToPrimary(int msecs, ConnectionType connec
         return true;
 
     if (socket->state() != QLocalSocket::ConnectedState) {
-        while (true) {
-            randomSleep();
+        // The primary instance starts listening before it releases the memory block, so the
+        // first attempt normally succeeds and retries only cover a busy or restarting server
+        for (int attempt = 0;; ++attempt) {
+            if (attempt > 0)
+                backoffSleep(attempt);
 
             if (socket->state() != QLocalSocket::ConnectingState)
                 socket->connectToServer(blockServerName);
@@ -238,8 +249,12 @@ bool SingleApplicationPrivate::connectToPrimary(int msecs, ConnectionType connec
             }
 
             // If connected break out of the loop
-            if (socket->state() == QLocalSocket::ConnectedState)
+            if (socket->state() == QLocalSocket::ConnectedState) {
+                framesSent = 0;
+                framesAcked = 0;
+                messagesWritten = 0;
                 break;
+            }
 
             // If elapsed time since start is longer than the method timeout return
             if (time.elapsed() >= msecs)
@@ -255,43 +270,181 @@ bool SingleApplicationPrivate::connectToPrimary(int msecs, ConnectionType connec
     writeStream.setVersion(QDataStream::Qt_5_6);
 #endif
 
+    writeStream << static_cast<quint32>(ProtocolVersion);
     writeStream << blockServerName.toLatin1();
     writeStream << static_cast<quint8>(connectionType);
     writeStream << instanceNumber;
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    quint16 checksum =
-        qChecksum(QByteArray(initMsg.constData(), static_cast<quint32>(initMsg.length())));
-#else
-    quint16 checksum = qChecksum(initMsg.constData(), static_cast<quint32>(initMsg.length()));
-#endif
-    writeStream << checksum;
 
-    return writeConfirmedMessage(static_cast<int>(msecs - time.elapsed()), initMsg);
+    // The init message is not confirmed on its own, it is pipelined with the messages that
+    // follow and acknowledged together with them
+    writeFrames({initMsg});
+
+    return true;
 }
 
-void SingleApplicationPrivate::writeAck(QLocalSocket *sock) {
-    sock->putChar('\n');
+/**
+ * @brief Acknowledges all frames received so far on the connection
+ */
+void SingleApplicationPrivate::writeAck(QLocalSocket *sock, quint32 framesReceived) {
+    const quint32 ack = qToBigEndian(framesReceived);
+    sock->write(reinterpret_cast<const char *>(&ack), sizeof(ack));
 }
 
-bool SingleApplicationPrivate::writeConfirmedMessage(int msecs, const QByteArray &msg,
-                                                     SingleApplication::SendMode sendMode) {
+/**
+ * @brief Writes each message as a length prefixed frame, all frames go out in a single write
+ */
+void SingleApplicationPrivate::writeFrames(const QList<QByteArray> &msgs) {
+    // Large payloads are replaced by a descriptor of the shared memory segment holding them
+    QList<QByteArray> descriptors;
+    descriptors.reserve(msgs.size());
+
+    qsizetype size = 0;
+    for (const auto &msg : msgs) {
+        QByteArray descriptor;
+        if (static_cast<quint64>(msg.size()) > SharedPayloadThreshold)
+            descriptor = createSharedPayload(msg);
+        size += static_cast<qsizetype>(FrameHeaderSize) +
+                (descriptor.isEmpty() ? msg.size() : descriptor.size());
+        descriptors.append(descriptor);
+    }
+
+    QByteArray frames;
+    frames.reserve(size);
+    for (qsizetype i = 0; i < msgs.size(); ++i) {
+        const QByteArray &descriptor = descriptors.at(i);
+        const QByteArray &payload = descriptor.isEmpty() ? msgs.at(i) : descriptor;
+        quint64 header = static_cast<quint64>(payload.size());
+        if (!descriptor.isEmpty())
+            header |= SharedPayloadFlag;
+        header = qToBigEndian(header);
+        const quint32 crc = qToBigEndian(checksum(payload.constData(), payload.size()));
+        frames.append(reinterpret_cast<const char *>(&header), sizeof(header));
+        frames.append(reinterpret_cast<const char *>(&crc), sizeof(crc));
+        frames.append(payload);
+    }
+
+    socket->write(frames);
+    socket->flush();
+    framesSent += static_cast<quint32>(msgs.size());
+}
+
+/**
+ * @brief Waits until the primary instance has acknowledged every frame sent
+ */
+bool SingleApplicationPrivate::waitForAcks(int msecs) {
     QElapsedTimer time;
     time.start();
 
-    // Frame 1: The header indicates the message length that follows
-    QByteArray header;
-    QDataStream headerStream(&header, QIODevice::WriteOnly);
+    while (true) {
+        // Acks are cumulative, only the latest one matters
+        quint32 ack;
+        while (socket->bytesAvailable() >= static_cast<qint64>(sizeof(ack))) {
+            socket->read(reinterpret_cast<char *>(&ack), sizeof(ack));
+            framesAcked = qFromBigEndian(ack);
+        }
+
+        if (framesAcked == framesSent)
+            return true;
+
+        const int remaining = static_cast<int>(msecs - time.elapsed());
+        if (remaining <= 0 || !socket->waitForReadyRead(remaining))
+            return false;
+    }
+}
+
+/**
+ * @brief Copies the message into a new shared memory segment and returns its descriptor, or an
+ * empty array if the segment cannot be created
+ * @note The segment is kept until the primary instance has acknowledged every frame sent, or
+ * until the instance exits
+ */
+QByteArray SingleApplicationPrivate::createSharedPayload(const QByteArray &msg) {
+    const QString key = blockServerName + QStringLiteral("-payload-") +
+                        QString::number(QCoreApplication::applicationPid()) + QLatin1Char('-') +
+                        QString::number(sharedPayloadCount++);
+
+    auto *segment = new QSharedMemory(key);
+    if (!segment->create(msg.size())) {
+        delete segment;
+        return {};
+    }
+    memcpy(segment->data(), msg.constData(), static_cast<size_t>(msg.size()));
+    sharedPayloads.append(segment);
+
+    QByteArray descriptor;
+    QDataStream writeStream(&descriptor, QIODevice::WriteOnly);
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
-    headerStream.setVersion(QDataStream::Qt_5_6);
+    writeStream.setVersion(QDataStream::Qt_5_6);
 #endif
-    headerStream << static_cast<quint64>(msg.length());
 
-    if (!writeConfirmedFrame(static_cast<int>(msecs - time.elapsed()), header))
-        return false;
+    writeStream << key;
+    writeStream << static_cast<quint64>(msg.size());
+    writeStream << checksum(msg.constData(), msg.size());
+    return descriptor;
+}
 
-    // Frame 2: The message
-    const bool result = writeConfirmedFrame(static_cast<int>(msecs - time.elapsed()), msg);
+/**
+ * @brief Maps the shared memory segment described by the descriptor and copies the payload out
+ * @note The copy is required, the delivered message must outlive the segment which the
+ * secondary instance destroys as soon as the frame is acknowledged
+ */
+QByteArray SingleApplicationPrivate::readSharedPayload(const QByteArray &descriptor,
+                                                       bool *ok) const {
+    *ok = false;
+
+    QDataStream readStream(descriptor);
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
+    readStream.setVersion(QDataStream::Qt_5_6);
+#endif
+
+    QString key;
+    quint64 size = 0;
+    quint32 payloadChecksum = 0;
+    readStream >> key >> size >> payloadChecksum;
+
+    // The segment must belong to this application
+    if (readStream.status() != QDataStream::Ok || !key.startsWith(blockServerName))
+        return {};
+
+    QSharedMemory segment(key);
+    if (!segment.attach(QSharedMemory::ReadOnly))
+        return {};
+
+    if (static_cast<quint64>(segment.size()) < size)
+        return {};
+
+    QByteArray payload(static_cast<const char *>(segment.constData()),
+                       static_cast<qsizetype>(size));
+    segment.detach();
+
+    if (checksum(payload.constData(), payload.size()) != payloadChecksum)
+        return {};
+
+    *ok = true;
+    return payload;
+}
+
+void SingleApplicationPrivate::releaseSharedPayloads() {
+    qDeleteAll(sharedPayloads);
+    sharedPayloads.clear();
+}
+
+quint32 SingleApplicationPrivate::checksum(const char *data, qsizetype size) {
+    return checksumFunction(data, size, 0);
+}
+
+bool SingleApplicationPrivate::writeConfirmedMessages(int msecs, const QList<QByteArray> &msgs,
+                                                      SingleApplication::SendMode sendMode) {
+    writeFrames(msgs);
+
+    const bool result = waitForAcks(msecs);
+
+    // The primary instance has copied the shared payloads once it acknowledges them, until then
+    // the segments must stay, the frames may still be read after the timeout
+    if (result)
+        releaseSharedPayloads();
 
     // Block if needed
     if (socket && sendMode == SingleApplication::BlockUntilPrimaryExit)
@@ -300,28 +453,9 @@ bool SingleApplicationPrivate::writeConfirmedMessage(int msecs, const QByteArray
     return result;
 }
 
-bool SingleApplicationPrivate::writeConfirmedFrame(int msecs, const QByteArray &msg) {
-    socket->write(msg);
-    socket->flush();
-
-    bool result = socket->waitForReadyRead(msecs); // await ack byte
-    if (result) {
-        socket->read(1);
-        return true;
-    }
-
-    return false;
-}
-
-quint16 SingleApplicationPrivate::blockChecksum() const {
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    quint16 checksum = qChecksum(QByteArray(static_cast<const char *>(memory->constData()),
-                                            offsetof(InstancesInfo, checksum)));
-#else
-    quint16 checksum = qChecksum(static_cast<const char *>(memory->constData()),
-                                 offsetof(InstancesInfo, checksum));
-#endif
-    return checksum;
+quint32 SingleApplicationPrivate::blockChecksum() const {
+    return checksum(static_cast<const char *>(memory->constData()),
+                    offsetof(InstancesInfo, checksum));
 }
 
 qint64 SingleApplicationPrivate::primaryPid() const {
@@ -353,10 +487,8 @@ void SingleApplicationPrivate::slotConnectionEstablished() {
     QLocalSocket *nextConnSocket = server->nextPendingConnection();
     connectionMap.insert(nextConnSocket, ConnectionInfo());
 
-    QObject::connect(nextConnSocket, &QLocalSocket::aboutToClose, this, [nextConnSocket, this]() {
-        auto &info = connectionMap[nextConnSocket];
-        this->slotClientConnectionClosed(nextConnSocket, info.instanceId);
-    });
+    QObject::connect(nextConnSocket, &QLocalSocket::aboutToClose, this,
+                     [nextConnSocket, this]() { slotClientConnectionClosed(nextConnSocket); });
 
     QObject::connect(nextConnSocket, &QLocalSocket::disconnected, nextConnSocket,
                      &QLocalSocket::deleteLater);
@@ -364,80 +496,121 @@ void SingleApplicationPrivate::slotConnectionEstablished() {
     QObject::connect(nextConnSocket, &QLocalSocket::destroyed, this,
                      [nextConnSocket, this]() { connectionMap.remove(nextConnSocket); });
 
-    QObject::connect(nextConnSocket, &QLocalSocket::readyRead, this, [nextConnSocket, this]() {
-        auto &info = connectionMap[nextConnSocket];
-        switch (info.stage) {
-            case StageInitHeader:
-                readMessageHeader(nextConnSocket, StageInitBody);
-                break;
-            case StageInitBody:
-                readInitMessageBody(nextConnSocket);
-                break;
-            case StageConnectedHeader:
-                readMessageHeader(nextConnSocket, StageConnectedBody);
-                break;
-            case StageConnectedBody:
-                this->slotDataAvailable(nextConnSocket, info.instanceId);
-                break;
-            default:
-                break;
-        };
-    });
+    QObject::connect(nextConnSocket, &QLocalSocket::readyRead, this,
+                     [nextConnSocket, this]() { readFrames(nextConnSocket); });
 }
 
-void SingleApplicationPrivate::readMessageHeader(
-    QLocalSocket *sock, SingleApplicationPrivate::ConnectionStage nextStage) {
-    if (!connectionMap.contains(sock)) {
-        return;
-    }
+/**
+ * @brief Consumes every complete frame available on the socket, acknowledges them with a
+ * single cumulative ack and then delivers the messages
+ */
+void SingleApplicationPrivate::readFrames(QLocalSocket *sock) {
+    Q_Q(SingleApplication);
 
-    if (sock->bytesAvailable() < (qint64) sizeof(quint64)) {
+    auto it = connectionMap.find(sock);
+    if (it == connectionMap.end())
         return;
-    }
 
-    QDataStream headerStream(sock);
-
-#if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
-    headerStream.setVersion(QDataStream::Qt_5_6);
-#endif
+    ConnectionInfo &info = it.value();
+    const quint32 framesBefore = info.framesReceived;
+    bool notify = false;
+    bool rejected = false;
+    QList<QByteArray> messages;
+
+    while (sock->bytesAvailable() >= static_cast<qint64>(FrameHeaderSize)) {
+        char header[FrameHeaderSize];
+        sock->peek(header, sizeof(header));
+        const quint64 lengthField = qFromBigEndian<quint64>(header);
+        const quint32 crc = qFromBigEndian<quint32>(header + sizeof(quint64));
+        const bool shared = lengthField & SharedPayloadFlag;
+        const quint64 msgLen = lengthField & ~SharedPayloadFlag;
+
+        if (!info.initialized && (shared || msgLen > MaxInitFrameSize)) {
+            connectionMap.erase(it);
+            sock->close();
+            return;
+        }
 
-    // Read the header to know the message length
-    quint64 msgLen = 0;
-    headerStream >> msgLen;
-    ConnectionInfo &info = connectionMap[sock];
-    info.stage = nextStage;
-    info.msgLen = msgLen;
+        if (static_cast<quint64>(sock->bytesAvailable()) < sizeof(header) + msgLen)
+            break;
+
+        sock->read(header, sizeof(header));
+        QByteArray msgBytes = sock->read(static_cast<qint64>(msgLen));
+
+        if (checksum(msgBytes.constData(), msgBytes.size()) != crc) {
+            // Instances before the versioned protocol frame the init message differently
+            if (!info.initialized)
+                qWarning() << "SingleApplication: Rejected an instance using an older protocol "
+                              "version";
+            else
+                qWarning() << "SingleApplication: Corrupted frame from instance"
+                           << info.instanceId;
+            connectionMap.erase(it);
+            sock->close();
+            return;
+        }
 
-    writeAck(sock);
-}
+        if (!info.initialized) {
+            if (!readInitFrame(info, msgBytes, &notify)) {
+                connectionMap.erase(it);
+                sock->close();
+                return;
+            }
+            info.framesReceived++;
+            continue;
+        }
 
-bool SingleApplicationPrivate::isFrameComplete(QLocalSocket *sock) {
-    if (!connectionMap.contains(sock)) {
-        return false;
+        if (shared) {
+            bool ok;
+            msgBytes = readSharedPayload(msgBytes, &ok);
+            if (!ok) {
+                // Like a corrupted frame the message is not acknowledged, the secondary instance
+                // keeps it queued and sends it again on a new connection
+                qWarning() << "SingleApplication: Unable to read the shared payload of a message "
+                              "from instance"
+                           << info.instanceId;
+                rejected = true;
+                break;
+            }
+        }
+        info.framesReceived++;
+        messages.append(msgBytes);
     }
 
-    ConnectionInfo &info = connectionMap[sock];
-    if (sock->bytesAvailable() < (qint64) info.msgLen) {
-        return false;
+    // Acknowledge before delivering so that the secondary instance can exit right away
+    if (info.framesReceived != framesBefore)
+        writeAck(sock, info.framesReceived);
+
+    const quint32 instanceId = info.instanceId;
+    if (rejected) {
+        sock->flush();
+        connectionMap.erase(it);
+        sock->close();
     }
+    if (notify)
+        Q_EMIT q->instanceStarted();
 
-    return true;
+    for (const auto &message : messages)
+        Q_EMIT q->receivedMessage(instanceId, message);
 }
 
-void SingleApplicationPrivate::readInitMessageBody(QLocalSocket *sock) {
-    Q_Q(SingleApplication);
-
-    if (!isFrameComplete(sock))
-        return;
-
-    // Read the message body
-    QByteArray msgBytes = sock->readAll();
+bool SingleApplicationPrivate::readInitFrame(ConnectionInfo &info, const QByteArray &msgBytes,
+                                             bool *notify) {
     QDataStream readStream(msgBytes);
 
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 6, 0))
     readStream.setVersion(QDataStream::Qt_5_6);
 #endif
 
+    // protocol version
+    quint32 version = 0;
+    readStream >> version;
+    if (readStream.status() != QDataStream::Ok || version != ProtocolVersion) {
+        qWarning() << "SingleApplication: Rejected an instance using protocol version" << version
+                   << "instead of" << ProtocolVersion;
+        return false;
+    }
+
     // server name
     QByteArray latin1Name;
     readStream >> latin1Name;
@@ -452,68 +625,33 @@ void SingleApplicationPrivate::readInitMessageBody(QLocalSocket *sock) {
     quint32 instanceId = 0;
     readStream >> instanceId;
 
-    // checksum
-    quint16 msgChecksum = 0;
-    readStream >> msgChecksum;
-
-#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
-    const quint16 actualChecksum = qChecksum(QByteArray(
-        msgBytes.constData(), static_cast<quint32>(msgBytes.length() - sizeof(quint16))));
-#else
-    const quint16 actualChecksum =
-        qChecksum(msgBytes.constData(), static_cast<quint32>(msgBytes.length() - sizeof(quint16)));
-#endif
-
-    bool isValid = readStream.status() == QDataStream::Ok &&
-                   QLatin1String(latin1Name) == blockServerName && msgChecksum == actualChecksum;
-
-    if (!isValid) {
-        sock->close();
-        return;
-    }
+    // The frame checksum has been verified already
+    if (readStream.status() != QDataStream::Ok || QLatin1String(latin1Name) != blockServerName)
+        return false;
 
-    ConnectionInfo &info = connectionMap[sock];
     info.instanceId = instanceId;
-    info.stage = StageConnectedHeader;
-
-    if (connectionType == NewInstance ||
-        (connectionType == SecondaryInstance &&
-         options & SingleApplication::Mode::SecondaryNotification)) {
-        Q_EMIT q->instanceStarted();
-    }
+    info.initialized = true;
 
-    writeAck(sock);
-}
-
-void SingleApplicationPrivate::slotDataAvailable(QLocalSocket *dataSocket, quint32 instanceId) {
-    Q_Q(SingleApplication);
-
-    if (!isFrameComplete(dataSocket))
-        return;
-
-    const QByteArray message = dataSocket->readAll();
-
-    writeAck(dataSocket);
-
-    ConnectionInfo &info = connectionMap[dataSocket];
-    info.stage = StageConnectedHeader;
-
-    Q_EMIT q->receivedMessage(instanceId, message);
+    *notify = connectionType == NewInstance ||
+              (connectionType == SecondaryInstance &&
+               options & SingleApplication::Mode::SecondaryNotification);
+    return true;
 }
 
-void SingleApplicationPrivate::slotClientConnectionClosed(QLocalSocket *closedSocket,
-                                                          quint32 instanceId) {
+void SingleApplicationPrivate::slotClientConnectionClosed(QLocalSocket *closedSocket) {
     if (closedSocket->bytesAvailable() > 0)
-        slotDataAvailable(closedSocket, instanceId);
+        readFrames(closedSocket);
 }
 
-void SingleApplicationPrivate::randomSleep() {
-#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
-    QThread::msleep(QRandomGenerator::global()->bounded(8u, 18u));
-#else
-    qsrand(QDateTime::currentMSecsSinceEpoch() % std::numeric_limits<uint>::max());
-    QThread::msleep(qrand() % 11 + 8);
-#endif
+/**
+ * @brief Short bounded backoff between retries: yield first, then sleep 1, 2, 4 and 8 ms
+ */
+void SingleApplicationPrivate::backoffSleep(int attempt) {
+    if (attempt <= 1) {
+        QThread::yieldCurrentThread();
+        return;
+    }
+    QThread::msleep(1u << qMin(attempt - 2, 3));
 }
 
 void SingleApplicationPrivate::addAppData(const QString &data) {
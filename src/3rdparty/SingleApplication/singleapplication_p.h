@@ -32,6 +32,7 @@
 #ifndef SINGLEAPPLICATION_P_H
 #define SINGLEAPPLICATION_P_H
 
+#include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtCore/QSharedMemory>
 #include <QtNetwork/QLocalServer>
@@ -40,17 +41,18 @@
 #include "singleapplication.h"
 
 struct InstancesInfo {
+    quint32 version; // Must be the first field, the block of the unversioned protocol is smaller
     bool primary;
     quint32 secondary;
     qint64 primaryPid;
     char primaryUser[128];
-    quint16 checksum; // Must be the last field
+    quint32 checksum; // Must be the last field
 };
 
 struct ConnectionInfo {
-    qint64 msgLen = 0;
     quint32 instanceId = 0;
-    quint8 stage = 0;
+    quint32 framesReceived = 0;
+    bool initialized = false;
 };
 
 class SingleApplicationPrivate : public QObject {
@@ -62,11 +64,24 @@ public:
         SecondaryInstance = 2,
         Reconnect = 3
     };
-    enum ConnectionStage : quint8 {
-        StageInitHeader = 0,
-        StageInitBody = 1,
-        StageConnectedHeader = 2,
-        StageConnectedBody = 3,
+    enum : quint32 {
+        // Version of the memory block layout and of the messages. Instances of all versions share
+        // the block and the server name, so that they detect each other and refuse to start
+        // instead of becoming primary side by side
+        ProtocolVersion = 2,
+    };
+    enum : quint64 {
+        // Length and checksum of the payload
+        FrameHeaderSize = sizeof(quint64) + sizeof(quint32),
+
+        // Upper bound of the init message, larger frames on a new connection are rejected
+        MaxInitFrameSize = 1024,
+
+        // Messages larger than this are passed through a shared memory segment
+        SharedPayloadThreshold = 64 * 1024,
+
+        // Set in the frame header when the frame carries a shared payload descriptor
+        SharedPayloadFlag = Q_UINT64_C(1) << 63,
     };
     Q_DECLARE_PUBLIC(SingleApplication)
 
@@ -79,18 +94,26 @@ public:
     void startPrimary();
     void startSecondary();
     bool connectToPrimary(int msecs, ConnectionType connectionType);
-    quint16 blockChecksum() const;
+    quint32 blockChecksum() const;
     qint64 primaryPid() const;
     QString primaryUser() const;
-    bool isFrameComplete(QLocalSocket *sock);
-    void readMessageHeader(QLocalSocket *socket, ConnectionStage nextStage);
-    void readInitMessageBody(QLocalSocket *socket);
-    void writeAck(QLocalSocket *sock);
-    bool writeConfirmedFrame(int msecs, const QByteArray &msg);
-    bool writeConfirmedMessage(
-        int msecs, const QByteArray &msg,
+    void readFrames(QLocalSocket *sock);
+    bool readInitFrame(ConnectionInfo &info, const QByteArray &msgBytes, bool *notify);
+    void writeAck(QLocalSocket *sock, quint32 framesReceived);
+    void writeFrames(const QList<QByteArray> &msgs);
+    QByteArray createSharedPayload(const QByteArray &msg);
+    QByteArray readSharedPayload(const QByteArray &descriptor, bool *ok) const;
+    void releaseSharedPayloads();
+
+    // CRC32C by default, messages and the memory block must agree on the function
+    using ChecksumFunction = quint32 (*)(const char *data, qsizetype size, quint32 crc);
+    static ChecksumFunction checksumFunction;
+    static quint32 checksum(const char *data, qsizetype size);
+    bool waitForAcks(int msecs);
+    bool writeConfirmedMessages(
+        int msecs, const QList<QByteArray> &msgs,
         SingleApplication::SendMode sendMode = SingleApplication::NonBlocking);
-    static void randomSleep();
+    static void backoffSleep(int attempt);
     void addAppData(const QString &data);
     QStringList appData() const;
 
@@ -102,12 +125,17 @@ public:
     QString blockServerName;
     SingleApplication::Options options;
     QMap<QLocalSocket *, ConnectionInfo> connectionMap;
+    QList<QByteArray> messageQueue;
+    qsizetype messagesWritten;
+    quint32 framesSent;
+    quint32 framesAcked;
+    QList<QSharedMemory *> sharedPayloads;
+    quint32 sharedPayloadCount;
     QStringList appDataList;
 
 public Q_SLOTS:
     void slotConnectionEstablished();
-    void slotDataAvailable(QLocalSocket *, quint32);
-    void slotClientConnectionClosed(QLocalSocket *, quint32);
+    void slotClientConnectionClosed(QLocalSocket *);
 };
 
 #endif // SINGLEAPPLICATION_P_H
@@ -0,0 +1,95 @@
+#include "asynctask.h"
+
+#include <utility>
+
+namespace Core {
+
+    /*!
+        \class AsyncTask
+        \brief Lazily started coroutine used by the asynchronous add-on hooks.
+
+        A coroutine returning AsyncTask does not run until it is awaited with \c co_await or
+        passed to start(). Use resumeOnThreadPool() to move blocking work off the GUI thread
+        and resumeOn() or resumeOnMainThread() to come back before touching GUI objects.
+    */
+
+    namespace {
+
+        struct DetachedTask {
+            struct promise_type {
+                DetachedTask get_return_object() const noexcept {
+                    return {};
+                }
+                std::suspend_never initial_suspend() const noexcept {
+                    return {};
+                }
+                std::suspend_never final_suspend() const noexcept {
+                    return {};
+                }
+                void return_void() const noexcept {
+                }
+                void unhandled_exception() const noexcept {
+                    // Only reachable if the finished callback throws
+                    std::terminate();
+                }
+            };
+        };
+
+        DetachedTask runDetached(AsyncTask task,
+                                 std::function<void(std::exception_ptr)> finished) {
+            std::exception_ptr exception;
+            try {
+                co_await task;
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            if (finished) {
+                finished(exception);
+            }
+        }
+
+    }
+
+    AsyncTask::AsyncTask() noexcept = default;
+
+    AsyncTask::AsyncTask(AsyncTask &&other) noexcept : m_handle(std::exchange(other.m_handle, {})) {
+    }
+
+    AsyncTask &AsyncTask::operator=(AsyncTask &&other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    AsyncTask::~AsyncTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool AsyncTask::isValid() const {
+        return bool(m_handle);
+    }
+
+    bool AsyncTask::isDone() const {
+        return m_handle && m_handle.done();
+    }
+
+    /*!
+        Starts \a task without an awaiting coroutine. If the task never suspends, it has
+        completed when this function returns. \a finished is called in the thread that
+        completes the task, with the exception the task exited with, if any.
+    */
+    void AsyncTask::start(AsyncTask task,
+                          const std::function<void(std::exception_ptr)> &finished) {
+        runDetached(std::move(task), finished);
+    }
+
+    AsyncTask::AsyncTask(Handle handle) noexcept : m_handle(handle) {
+    }
+
+}
@@ -0,0 +1,133 @@
+#ifndef CHORUSKIT_ASYNCTASK_H
+#define CHORUSKIT_ASYNCTASK_H
+
+#include <coroutine>
+#include <exception>
+#include <functional>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMetaObject>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include <CoreApi/ckappcoreglobal.h>
+
+namespace Core {
+
+    class CKAPPCORE_EXPORT AsyncTask {
+    public:
+        struct promise_type {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+
+            struct FinalAwaiter {
+                inline bool await_ready() const noexcept {
+                    return false;
+                }
+                inline std::coroutine_handle<>
+                    await_suspend(std::coroutine_handle<promise_type> h) const noexcept {
+                    auto continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                inline void await_resume() const noexcept {
+                }
+            };
+
+            inline AsyncTask get_return_object() noexcept {
+                return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            inline std::suspend_always initial_suspend() const noexcept {
+                return {};
+            }
+            inline FinalAwaiter final_suspend() const noexcept {
+                return {};
+            }
+            inline void return_void() const noexcept {
+            }
+            inline void unhandled_exception() noexcept {
+                exception = std::current_exception();
+            }
+        };
+
+        using Handle = std::coroutine_handle<promise_type>;
+
+        // Resumes the awaiting coroutine in the event loop of the context's thread
+        struct ContextAwaiter {
+            QObject *context;
+            bool alwaysPost;
+
+            inline bool await_ready() const noexcept {
+                return !alwaysPost && QThread::currentThread() == context->thread();
+            }
+            inline void await_suspend(std::coroutine_handle<> h) const {
+                QMetaObject::invokeMethod(
+                    context, [h] { h.resume(); }, Qt::QueuedConnection);
+            }
+            inline void await_resume() const noexcept {
+            }
+        };
+
+        // Resumes the awaiting coroutine on a worker thread of the pool
+        struct ThreadPoolAwaiter {
+            QThreadPool *pool;
+
+            inline bool await_ready() const noexcept {
+                return false;
+            }
+            inline void await_suspend(std::coroutine_handle<> h) const {
+                (pool ? pool : QThreadPool::globalInstance())->start([h] { h.resume(); });
+            }
+            inline void await_resume() const noexcept {
+            }
+        };
+
+    public:
+        AsyncTask() noexcept;
+        AsyncTask(AsyncTask &&other) noexcept;
+        AsyncTask &operator=(AsyncTask &&other) noexcept;
+        ~AsyncTask();
+
+        bool isValid() const;
+        bool isDone() const;
+
+        static void start(AsyncTask task,
+                          const std::function<void(std::exception_ptr)> &finished = {});
+
+        static inline ContextAwaiter resumeOn(QObject *context) {
+            return {context, false};
+        }
+        static inline ContextAwaiter resumeOnMainThread() {
+            return {QCoreApplication::instance(), false};
+        }
+        static inline ContextAwaiter yieldToEventLoop(QObject *context = nullptr) {
+            return {context ? context : QCoreApplication::instance(), true};
+        }
+        static inline ThreadPoolAwaiter resumeOnThreadPool(QThreadPool *pool = nullptr) {
+            return {pool};
+        }
+
+    public:
+        inline bool await_ready() const noexcept {
+            return !m_handle || m_handle.done();
+        }
+        inline std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+            m_handle.promise().continuation = awaiting;
+            return m_handle;
+        }
+        inline void await_resume() const {
+            if (m_handle && m_handle.promise().exception) {
+                std::rethrow_exception(m_handle.promise().exception);
+            }
+        }
+
+    private:
+        explicit AsyncTask(Handle handle) noexcept;
+
+        Handle m_handle;
+
+        Q_DISABLE_COPY(AsyncTask)
+    };
+
+}
+
+#endif // CHORUSKIT_ASYNCTASK_H
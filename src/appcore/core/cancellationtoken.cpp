@@ -0,0 +1,26 @@
+#include "cancellationtoken.h"
+
+namespace Core {
+
+    /*!
+        \class CancellationToken
+        \brief Thread-safe flag shared by all copies of a token.
+
+        Long running work, typically on a worker thread, should poll isCancellationRequested()
+        and return early once the owner has requested cancellation.
+    */
+
+    CancellationToken::CancellationToken() : m_cancelled(std::make_shared<std::atomic_bool>(false)) {
+    }
+
+    CancellationToken::~CancellationToken() = default;
+
+    bool CancellationToken::isCancellationRequested() const {
+        return m_cancelled->load(std::memory_order_acquire);
+    }
+
+    void CancellationToken::requestCancellation() {
+        m_cancelled->store(true, std::memory_order_release);
+    }
+
+}
@@ -0,0 +1,25 @@
+#ifndef CHORUSKIT_CANCELLATIONTOKEN_H
+#define CHORUSKIT_CANCELLATIONTOKEN_H
+
+#include <atomic>
+#include <memory>
+
+#include <CoreApi/ckappcoreglobal.h>
+
+namespace Core {
+
+    class CKAPPCORE_EXPORT CancellationToken {
+    public:
+        CancellationToken();
+        ~CancellationToken();
+
+        bool isCancellationRequested() const;
+        void requestCancellation();
+
+    private:
+        std::shared_ptr<std::atomic_bool> m_cancelled;
+    };
+
+}
+
+#endif // CHORUSKIT_CANCELLATIONTOKEN_H
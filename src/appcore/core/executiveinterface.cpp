@@ -1,10 +1,35 @@
 #include "executiveinterface.h"
 #include "executiveinterface_p.h"
 
+#include <exception>
+#include <memory>
+
+#include <QEventLoop>
+#include <QPointer>
+#include <QtCore/QLoggingCategory>
+
 namespace Core {
 
+    Q_STATIC_LOGGING_CATEGORY(lcExecutiveInterface, "ck.executiveinterface")
+
     static const int DELAYED_INITIALIZE_INTERVAL = 5; // ms
 
+    static const int QUIT_WAIT_TIMEOUT = 3000; // ms
+
+    // Completes on the main thread, where an exception thrown by the add-on is rethrown
+    static AsyncTask awaitOnMainThread(AsyncTask task) {
+        std::exception_ptr exception;
+        try {
+            co_await task;
+        } catch (...) {
+            exception = std::current_exception();
+        }
+        co_await AsyncTask::resumeOnMainThread();
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
     ExecutiveInterfaceAddOnPrivate::ExecutiveInterfaceAddOnPrivate() {
     }
 
@@ -19,10 +44,53 @@ namespace Core {
     ExecutiveInterfaceAddOn::~ExecutiveInterfaceAddOn() {
     }
 
+    void ExecutiveInterfaceAddOn::initialize() {
+    }
+
+    void ExecutiveInterfaceAddOn::extensionsInitialized() {
+    }
+
     bool ExecutiveInterfaceAddOn::delayedInitialize() {
         return false;
     }
 
+    /*!
+        Cancellable variant of delayedInitialize(), the default implementation calls
+        delayedInitialize(). Long running work should return early once \a token is cancelled,
+        which happens when the host quits before the delayed initialization has finished.
+    */
+    bool ExecutiveInterfaceAddOn::delayedInitializeCancellable(const CancellationToken &token) {
+        Q_UNUSED(token)
+        return delayedInitialize();
+    }
+
+    /*!
+        Asynchronous variant of initialize(), the default implementation calls initialize().
+
+        The host awaits the returned task before calling the next add-on, and the state only
+        moves to \c Initialized after all add-ons have completed. Override it and use
+        AsyncTask::resumeOnThreadPool() to keep blocking I/O off the GUI thread, checking
+        \a token between steps since the host waits only a bounded time for it on quit.
+
+        An exception thrown by the hook stops the loading. It propagates to the caller that
+        loads the host if no add-on has suspended before, otherwise it is logged.
+    */
+    AsyncTask ExecutiveInterfaceAddOn::initializeAsync(CancellationToken token) {
+        Q_UNUSED(token)
+        initialize();
+        co_return;
+    }
+
+    /*!
+        Asynchronous variant of extensionsInitialized(), the default implementation calls
+        extensionsInitialized(). The state moves to \c Running after all add-ons have completed.
+    */
+    AsyncTask ExecutiveInterfaceAddOn::extensionsInitializedAsync(CancellationToken token) {
+        Q_UNUSED(token)
+        extensionsInitialized();
+        co_return;
+    }
+
     ExecutiveInterface *ExecutiveInterfaceAddOn::host() const {
         Q_D(const ExecutiveInterfaceAddOn);
         return d->host;
@@ -37,9 +105,12 @@ namespace Core {
     ExecutiveInterfacePrivate::ExecutiveInterfacePrivate() {
         state = ExecutiveInterface::Preparatory;
         delayedInitializeTimer = nullptr;
+        loadingAddOns = false;
+        quitWaitLoop = nullptr;
     }
 
     ExecutiveInterfacePrivate::~ExecutiveInterfacePrivate() {
+        cancellationToken.requestCancellation();
         stopDelayedTimer();
     }
 
@@ -47,24 +118,76 @@ namespace Core {
     }
 
     void ExecutiveInterfacePrivate::load(bool enableDelayed) {
-        Q_Q(ExecutiveInterface);
-
         // Setup
         changeLoadState(ExecutiveInterface::Starting);
 
+        // Completes synchronously unless an add-on suspends in its asynchronous hooks
+        loadingAddOns = true;
+        detachedAddOns = std::make_shared<QList<ExecutiveInterfaceAddOn *>>();
+        QPointer<ExecutiveInterface> guard(q_func());
+        auto returned = std::make_shared<bool>(false);
+        std::exception_ptr syncException;
+        AsyncTask::start(loadAddOns(enableDelayed),
+                         [this, guard, returned, detached = detachedAddOns,
+                          &syncException](std::exception_ptr exception) {
+                             for (auto addOn : std::as_const(*detached)) {
+                                 addOn->deleteLater();
+                             }
+                             detached->clear();
+                             if (guard) {
+                                 loadingAddOns = false;
+                                 if (quitWaitLoop)
+                                     quitWaitLoop->quit();
+                             }
+                             if (!exception)
+                                 return;
+                             if (!*returned) {
+                                 syncException = exception;
+                                 return;
+                             }
+
+                             // The caller has returned once an add-on suspended
+                             try {
+                                 std::rethrow_exception(exception);
+                             } catch (const std::exception &e) {
+                                 qCCritical(lcExecutiveInterface)
+                                     << "Add-on initialization failed:" << e.what();
+                             } catch (...) {
+                                 qCCritical(lcExecutiveInterface)
+                                     << "Add-on initialization failed with an unknown exception";
+                             }
+                         });
+        *returned = true;
+
+        // Propagates to the caller as the synchronous hooks did
+        if (syncException)
+            std::rethrow_exception(syncException);
+    }
+
+    AsyncTask ExecutiveInterfacePrivate::loadAddOns(bool enableDelayed) {
+        Q_Q(ExecutiveInterface);
+
+        // Add-ons may resume on other threads, always come back before touching the host
+        QPointer<ExecutiveInterface> guard(q);
+        const auto addOnList = addOns;
+
         // Initialize
-        for (auto &addOn : qAsConst(addOns)) {
+        for (auto addOn : addOnList) {
             // Call 1
-            addOn->initialize();
+            co_await awaitOnMainThread(addOn->initializeAsync(cancellationToken));
+            if (!guard || cancellationToken.isCancellationRequested())
+                co_return;
         }
 
         changeLoadState(ExecutiveInterface::Initialized);
 
         // ExtensionsInitialized
-        for (auto it2 = addOns.rbegin(); it2 != addOns.rend(); ++it2) {
-            auto &addOn = *it2;
+        for (auto it2 = addOnList.rbegin(); it2 != addOnList.rend(); ++it2) {
+            auto addOn = *it2;
             // Call 2
-            addOn->extensionsInitialized();
+            co_await awaitOnMainThread(addOn->extensionsInitializedAsync(cancellationToken));
+            if (!guard || cancellationToken.isCancellationRequested())
+                co_return;
         }
 
         // Add-ons finished
@@ -72,7 +195,7 @@ namespace Core {
 
         if (enableDelayed) {
             // Delayed initialize
-            delayedInitializeQueue = addOns;
+            delayedInitializeQueue = addOnList;
 
             delayedInitializeTimer = new QTimer();
             delayedInitializeTimer->setInterval(DELAYED_INITIALIZE_INTERVAL);
@@ -85,17 +208,46 @@ namespace Core {
         }
     }
 
+    void ExecutiveInterfacePrivate::waitForAddOns(int msecs) {
+        if (!loadingAddOns)
+            return;
+
+        // Let suspended add-on hooks observe the cancellation and unwind
+        QEventLoop loop;
+        quitWaitLoop = &loop;
+        QTimer::singleShot(msecs, &loop, &QEventLoop::quit);
+        loop.exec(QEventLoop::ExcludeUserInputEvents);
+        quitWaitLoop = nullptr;
+
+        if (loadingAddOns) {
+            qCWarning(lcExecutiveInterface)
+                << "Add-on initialization still in progress after" << msecs
+                << "ms, add-ons are deleted once it finishes";
+        }
+    }
+
     void ExecutiveInterfacePrivate::quit() {
         Q_Q(ExecutiveInterface);
 
+        // Stop pending and in-flight initializations
+        cancellationToken.requestCancellation();
         stopDelayedTimer();
+        waitForAddOns(QUIT_WAIT_TIMEOUT);
 
         changeLoadState(ExecutiveInterface::Exiting);
 
-        // Delete addOns
-        for (auto it2 = addOns.rbegin(); it2 != addOns.rend(); ++it2) {
-            auto &addOn = *it2;
-            addOn->deleteLater();
+        if (loadingAddOns) {
+            // Suspended hooks resume into their add-ons, keep them beyond the host's lifetime
+            for (auto addOn : std::as_const(addOns)) {
+                addOn->setParent(nullptr);
+            }
+            *detachedAddOns = addOns;
+        } else {
+            // Delete addOns
+            for (auto it2 = addOns.rbegin(); it2 != addOns.rend(); ++it2) {
+                auto &addOn = *it2;
+                addOn->deleteLater();
+            }
         }
 
         changeLoadState(ExecutiveInterface::Deleted);
@@ -123,10 +275,15 @@ namespace Core {
         Q_Q(ExecutiveInterface);
 
         while (!delayedInitializeQueue.empty()) {
+            if (cancellationToken.isCancellationRequested()) {
+                delayedInitializeQueue.clear();
+                return;
+            }
+
             auto addOn = delayedInitializeQueue.front();
             delayedInitializeQueue.pop_front();
 
-            bool delay = addOn->delayedInitialize();
+            bool delay = addOn->delayedInitializeCancellable(cancellationToken);
             if (delay)
                 break; // do next delayedInitialize after a delay
         }
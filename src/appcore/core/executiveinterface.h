@@ -4,6 +4,8 @@
 #include <QObject>
 
 #include <CoreApi/objectpool.h>
+#include <CoreApi/asynctask.h>
+#include <CoreApi/cancellationtoken.h>
 
 namespace Core {
 
@@ -20,9 +22,13 @@ namespace Core {
         explicit ExecutiveInterfaceAddOn(QObject *parent = nullptr);
         ~ExecutiveInterfaceAddOn();
 
-        virtual void initialize() = 0;
-        virtual void extensionsInitialized() = 0;
+        virtual void initialize();
+        virtual void extensionsInitialized();
         virtual bool delayedInitialize();
+        virtual bool delayedInitializeCancellable(const CancellationToken &token);
+
+        virtual AsyncTask initializeAsync(CancellationToken token);
+        virtual AsyncTask extensionsInitializedAsync(CancellationToken token);
 
     public:
         ExecutiveInterface *host() const;
@@ -1,11 +1,15 @@
 #ifndef EXECUTIVEINTERFACEPRIVATE_H
 #define EXECUTIVEINTERFACEPRIVATE_H
 
+#include <memory>
+
 #include <QTimer>
 
 #include <CoreApi/executiveinterface.h>
 #include <CoreApi/private/objectpool_p.h>
 
+class QEventLoop;
+
 namespace Core {
 
     class CKAPPCORE_EXPORT ExecutiveInterfaceAddOnPrivate : public QObject {
@@ -32,6 +36,9 @@ namespace Core {
         virtual void load(bool enableDelayed);
         virtual void quit();
 
+        AsyncTask loadAddOns(bool enableDelayed);
+        void waitForAddOns(int msecs);
+
         void changeLoadState(ExecutiveInterface::State newState);
 
         void stopDelayedTimer();
@@ -42,6 +49,13 @@ namespace Core {
 
         QTimer *delayedInitializeTimer;
         QList<ExecutiveInterfaceAddOn *> delayedInitializeQueue;
+
+        CancellationToken cancellationToken;
+        bool loadingAddOns;
+        QEventLoop *quitWaitLoop;
+
+        // Add-ons whose hooks were still suspended on quit, deleted once the loading unwinds
+        std::shared_ptr<QList<ExecutiveInterfaceAddOn *>> detachedAddOns;
     };
 
 }
@@ -1,6 +1,7 @@
 #include "runtimeinterface.h"
 
 #include <CoreApi/private/runtimeinterface_p.h>
+#include <CoreApi/private/recentfilethumbnailprovider_p.h>
 
 #include <QApplication>
 #include <QCoreApplication>
@@ -126,6 +127,12 @@ namespace Core {
 
     void RuntimeInterface::setQmlEngine(QQmlEngine *qmlEngine) {
         RuntimeInterfacePrivate::instance()->qmlEngine = qmlEngine;
+
+        // Serves RecentFileCollection::thumbnailPath()
+        const QString providerId = RecentFileThumbnailProvider::providerId();
+        if (qmlEngine && !qmlEngine->imageProvider(providerId)) {
+            qmlEngine->addImageProvider(providerId, new RecentFileThumbnailProvider());
+        }
     }
 
     QSplashScreen *RuntimeInterface::splash() {
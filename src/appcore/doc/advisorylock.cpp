@@ -0,0 +1,296 @@
+#include "advisorylock_p.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QHostInfo>
+
+#ifdef Q_OS_WINDOWS
+#  include <io.h>
+#  include <qt_windows.h>
+#else
+#  include <cerrno>
+#  include <signal.h>
+#  include <sys/file.h>
+#  include <sys/stat.h>
+#endif
+
+namespace Core {
+
+    // Owner information of a lock that cannot be verified by the OS is trusted for this long
+    static constexpr qint64 STALE_LOCK_TIME = 24 * 60 * 60;
+
+    // Number of attempts when the sidecar is replaced while locking it
+    static constexpr int LOCK_ATTEMPTS = 3;
+
+#ifdef Q_OS_WINDOWS
+    // Lock a byte far past the end, so that the owner information and mapped files stay readable
+    static constexpr DWORD LOCK_OFFSET_HIGH = 0x7fffffff;
+#endif
+
+    static bool isProcessAlive(qint64 pid) {
+#ifdef Q_OS_WINDOWS
+        HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, DWORD(pid));
+        if (!process) {
+            return GetLastError() == ERROR_ACCESS_DENIED;
+        }
+        DWORD exitCode = 0;
+        bool alive = GetExitCodeProcess(process, &exitCode) && exitCode == STILL_ACTIVE;
+        CloseHandle(process);
+        return alive;
+#else
+        return ::kill(pid_t(pid), 0) == 0 || errno == EPERM;
+#endif
+    }
+
+    AdvisoryLock::AdvisoryLock(const QString &filePath)
+        : m_lockPath(lockFilePath(filePath)), m_mode(FileLocker::Unlocked) {
+    }
+
+    AdvisoryLock::~AdvisoryLock() {
+        unlock();
+    }
+
+    QString AdvisoryLock::lockFilePath(const QString &filePath) {
+        return filePath + QStringLiteral(".lock");
+    }
+
+    FileLocker::LockMode AdvisoryLock::mode() const {
+        return m_mode;
+    }
+
+    AdvisoryLock::Result AdvisoryLock::tryLock(FileLocker::LockMode mode,
+                                               FileLocker::LockOwner *owner,
+                                               QString *errorString) {
+        if (mode == FileLocker::Unlocked) {
+            unlock();
+            return Locked;
+        }
+        if (m_mode == mode) {
+            return Locked;
+        }
+
+        const auto previousMode = m_mode;
+        for (int attempt = 0; attempt < LOCK_ATTEMPTS; ++attempt) {
+            if (!m_file.isOpen()) {
+                m_file.setFileName(m_lockPath);
+                if (!m_file.open(QIODevice::ReadWrite)) {
+                    *errorString = m_file.errorString();
+                    return Error;
+                }
+            }
+
+            switch (lockNative(mode)) {
+                case NativeLocked:
+                    // The previous holder removed the sidecar while we were opening it
+                    if (!isCurrentFile()) {
+                        unlockNative();
+                        m_file.close();
+                        m_mode = FileLocker::Unlocked;
+                        continue;
+                    }
+                    m_mode = mode;
+                    if (mode == FileLocker::ExclusiveLock) {
+                        writeOwner();
+                    } else if (previousMode == FileLocker::ExclusiveLock) {
+                        m_file.resize(0);
+                    }
+                    return Locked;
+
+                case WouldBlock:
+                    // Converting a lock is not atomic, the held one may have been dropped
+                    if (previousMode != FileLocker::Unlocked &&
+                        lockNative(previousMode) != NativeLocked) {
+                        m_mode = FileLocker::Unlocked;
+                    }
+                    readOwner(m_lockPath, owner);
+                    *errorString = QCoreApplication::translate(
+                        "Core::FileLocker", "The file is locked by another process");
+                    return Conflict;
+
+                case Unsupported: {
+                    // The file system has no locks, e.g. some network shares. Trust the owner
+                    // information if it belongs to a live process.
+                    FileLocker::LockOwner current;
+                    if (readOwner(m_lockPath, &current) &&
+                        current.pid != QCoreApplication::applicationPid() && !isStale(current)) {
+                        *owner = current;
+                        *errorString = QCoreApplication::translate(
+                            "Core::FileLocker", "The file is locked by another process");
+                        return Conflict;
+                    }
+                    m_mode = mode;
+                    if (mode == FileLocker::ExclusiveLock) {
+                        writeOwner();
+                    }
+                    return Locked;
+                }
+
+                case Failed:
+                    *errorString = qt_error_string();
+                    if (previousMode != FileLocker::Unlocked &&
+                        lockNative(previousMode) != NativeLocked) {
+                        m_mode = FileLocker::Unlocked;
+                    }
+                    return Error;
+            }
+        }
+
+        *errorString = QCoreApplication::translate("Core::FileLocker",
+                                                   "The lock file keeps being replaced");
+        return Error;
+    }
+
+    void AdvisoryLock::unlock() {
+        if (m_mode == FileLocker::Unlocked) {
+            m_file.close();
+            return;
+        }
+
+        bool exclusive = m_mode == FileLocker::ExclusiveLock;
+        if (exclusive) {
+            m_file.resize(0);
+        }
+
+#ifdef Q_OS_WINDOWS
+        unlockNative();
+        m_file.close();
+
+        // Fails while another process has the sidecar open, which is what we want
+        QFile::remove(m_lockPath);
+#else
+        // Only remove the sidecar if nobody else holds it, waiters check the inode after
+        // locking and retry with a new sidecar
+        if (exclusive || ::flock(m_file.handle(), LOCK_EX | LOCK_NB) == 0) {
+            QFile::remove(m_lockPath);
+        }
+        unlockNative();
+        m_file.close();
+#endif
+        m_mode = FileLocker::Unlocked;
+    }
+
+    AdvisoryLock::NativeResult AdvisoryLock::lockNative(FileLocker::LockMode mode) {
+#ifdef Q_OS_WINDOWS
+        // Changing the mode of a held lock is not atomic on Windows
+        if (m_mode != FileLocker::Unlocked) {
+            unlockNative();
+        }
+#endif
+        return lockHandle(m_file.handle(), mode, false);
+    }
+
+    void AdvisoryLock::unlockNative() {
+        unlockHandle(m_file.handle());
+    }
+
+    AdvisoryLock::NativeResult AdvisoryLock::lockHandle(int fd, FileLocker::LockMode mode,
+                                                        bool wait) {
+#ifdef Q_OS_WINDOWS
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+
+        OVERLAPPED overlapped = {};
+        overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+        DWORD flags = wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY;
+        if (mode == FileLocker::ExclusiveLock) {
+            flags |= LOCKFILE_EXCLUSIVE_LOCK;
+        }
+        if (LockFileEx(handle, flags, 0, 1, 0, &overlapped)) {
+            return NativeLocked;
+        }
+        switch (GetLastError()) {
+            case ERROR_LOCK_VIOLATION:
+            case ERROR_IO_PENDING:
+                return WouldBlock;
+            case ERROR_NOT_SUPPORTED:
+            case ERROR_INVALID_FUNCTION:
+                return Unsupported;
+            default:
+                return Failed;
+        }
+#else
+        int operation = mode == FileLocker::ExclusiveLock ? LOCK_EX : LOCK_SH;
+        if (!wait) {
+            operation |= LOCK_NB;
+        }
+        int ret;
+        do {
+            ret = ::flock(fd, operation);
+        } while (ret != 0 && errno == EINTR);
+
+        if (ret == 0) {
+            return NativeLocked;
+        }
+        switch (errno) {
+            case EWOULDBLOCK:
+                return WouldBlock;
+            case ENOLCK:
+            case EOPNOTSUPP:
+            case EINVAL:
+                return Unsupported;
+            default:
+                return Failed;
+        }
+#endif
+    }
+
+    void AdvisoryLock::unlockHandle(int fd) {
+#ifdef Q_OS_WINDOWS
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+        OVERLAPPED overlapped = {};
+        overlapped.OffsetHigh = LOCK_OFFSET_HIGH;
+        UnlockFileEx(handle, 0, 1, 0, &overlapped);
+#else
+        ::flock(fd, LOCK_UN);
+#endif
+    }
+
+    bool AdvisoryLock::isCurrentFile() const {
+#ifdef Q_OS_WINDOWS
+        // The sidecar cannot be removed while it is open
+        return true;
+#else
+        struct stat fileStat, pathStat;
+        if (::fstat(m_file.handle(), &fileStat) != 0 ||
+            ::stat(QFile::encodeName(m_lockPath).constData(), &pathStat) != 0) {
+            return false;
+        }
+        return fileStat.st_dev == pathStat.st_dev && fileStat.st_ino == pathStat.st_ino;
+#endif
+    }
+
+    bool AdvisoryLock::writeOwner() {
+        const QByteArray content =
+            QByteArray::number(QCoreApplication::applicationPid()) + '\n' +
+            QHostInfo::localHostName().toUtf8() + '\n' +
+            QCoreApplication::applicationName().toUtf8() + '\n' +
+            QDateTime::currentDateTimeUtc().toString(Qt::ISODate).toUtf8() + '\n';
+        return m_file.resize(0) && m_file.seek(0) && m_file.write(content) == content.size() &&
+               m_file.flush();
+    }
+
+    bool AdvisoryLock::readOwner(const QString &lockPath, FileLocker::LockOwner *owner) {
+        QFile file(lockPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        const auto lines = file.read(4096).split('\n');
+        if (lines.size() < 4) {
+            return false;
+        }
+        owner->pid = lines.at(0).toLongLong();
+        owner->hostName = QString::fromUtf8(lines.at(1));
+        owner->applicationName = QString::fromUtf8(lines.at(2));
+        owner->lockTime = QDateTime::fromString(QString::fromUtf8(lines.at(3)), Qt::ISODate);
+        return owner->pid > 0;
+    }
+
+    bool AdvisoryLock::isStale(const FileLocker::LockOwner &owner) {
+        if (owner.hostName == QHostInfo::localHostName()) {
+            return !isProcessAlive(owner.pid);
+        }
+        // The process of another host cannot be checked
+        return !owner.lockTime.isValid() ||
+               owner.lockTime.secsTo(QDateTime::currentDateTimeUtc()) > STALE_LOCK_TIME;
+    }
+
+}
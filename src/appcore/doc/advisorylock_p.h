@@ -0,0 +1,63 @@
+#ifndef CHORUSKIT_ADVISORYLOCK_P_H
+#define CHORUSKIT_ADVISORYLOCK_P_H
+
+#include <QFile>
+
+#include <CoreApi/filelocker.h>
+
+namespace Core {
+
+    // Cross-process lock of a document, held on a `<path>.lock` sidecar so that it survives
+    // atomic saves replacing the document. Uses flock() on Unix and LockFileEx() on Windows.
+    // The exclusive holder writes its owner information into the sidecar.
+    class AdvisoryLock {
+    public:
+        explicit AdvisoryLock(const QString &filePath);
+        ~AdvisoryLock();
+
+        static QString lockFilePath(const QString &filePath);
+
+        FileLocker::LockMode mode() const;
+
+        enum Result {
+            Locked,
+            Conflict,
+            Error,
+        };
+
+        // On a conflict the owner is filled if it has written its information
+        Result tryLock(FileLocker::LockMode mode, FileLocker::LockOwner *owner,
+                       QString *errorString);
+        void unlock();
+
+        enum NativeResult {
+            NativeLocked,
+            WouldBlock,
+            Unsupported,
+            Failed,
+        };
+
+        // Native lock of a whole open file, without the sidecar. A byte far past the end is
+        // locked on Windows, so that the contents stay readable and mappable
+        static NativeResult lockHandle(int fd, FileLocker::LockMode mode, bool wait);
+        static void unlockHandle(int fd);
+
+    private:
+        QString m_lockPath;
+        QFile m_file;
+        FileLocker::LockMode m_mode;
+
+        NativeResult lockNative(FileLocker::LockMode mode);
+        void unlockNative();
+        bool isCurrentFile() const;
+
+        bool writeOwner();
+        static bool readOwner(const QString &lockPath, FileLocker::LockOwner *owner);
+        static bool isStale(const FileLocker::LockOwner &owner);
+
+        Q_DISABLE_COPY(AdvisoryLock)
+    };
+
+}
+
+#endif // CHORUSKIT_ADVISORYLOCK_P_H
@@ -1,37 +1,243 @@
 #include "filelocker.h"
 #include "filelocker_p.h"
+#include "xxhash64_p.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <utility>
 
 #include <QDir>
 #include <QFileInfo>
 #include <QLoggingCategory>
 #include <QIODevice>
 #include <QFileSystemWatcher>
+#include <QSaveFile>
+#include <QTimer>
+
+#ifdef Q_OS_WINDOWS
+#  include <io.h>
+#  include <qt_windows.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
 
 namespace Core {
 
     Q_STATIC_LOGGING_CATEGORY(lcFileLocker, "ck.filelocker")
 
+    // Watcher notifications arriving within this interval in milliseconds are checked once
+    static constexpr int CHANGE_DEBOUNCE_INTERVAL = 100;
+
+    // A journal smaller than this is never compacted for being larger than the image
+    static constexpr qint64 MIN_COMPACTION_THRESHOLD = 64 * 1024;
+
+    bool syncFile(QFileDevice *file) {
+        if (!file->flush()) {
+            return false;
+        }
+#if defined(Q_OS_WINDOWS)
+        auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(file->handle()));
+        return handle != INVALID_HANDLE_VALUE && FlushFileBuffers(handle);
+#else
+#  ifdef Q_OS_MACOS
+        // fsync() doesn't flush the drive cache on macOS
+        if (::fcntl(file->handle(), F_FULLFSYNC) == 0) {
+            return true;
+        }
+#  endif
+        return ::fsync(file->handle()) == 0;
+#endif
+    }
+
+    // Makes a rename in the directory durable
+    static bool syncDirectory(const QString &filePath) {
+#if defined(Q_OS_UNIX)
+        const QByteArray dirPath = QFile::encodeName(QFileInfo(filePath).absolutePath());
+        int fd = ::open(dirPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+#else
+        // NTFS journals the rename with its metadata
+        Q_UNUSED(filePath)
+        return true;
+#endif
+    }
+
+    static bool writeInPlace(QFile *file, const QByteArray &data, QString *errorString) {
+        if (!file->seek(0)) {
+            *errorString = file->errorString();
+            qCWarning(lcFileLocker) << "Failed to seek to beginning for save:" << *errorString;
+            return false;
+        }
+
+        if (file->write(data) != data.size()) {
+            *errorString = file->errorString();
+            qCWarning(lcFileLocker) << "Failed to write data:" << *errorString;
+            return false;
+        }
+
+        // Truncate file at current position
+        if (!file->resize(file->pos())) {
+            *errorString = file->errorString();
+            qCWarning(lcFileLocker) << "Failed to resize file:" << *errorString;
+            return false;
+        }
+
+        if (!syncFile(file)) {
+            *errorString = file->errorString();
+            qCWarning(lcFileLocker) << "Failed to flush file:" << *errorString;
+            return false;
+        }
+        return true;
+    }
+
+    // Reads the file sequentially in chunks, the consumer returns false to stop
+    static bool readInChunks(const QString &filePath, qint64 chunkSize,
+                             const std::atomic_bool &cancelled,
+                             const std::function<bool(QByteArrayView, qint64)> &consumer,
+                             QString *errorString) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::ExistingOnly | QIODevice::Unbuffered)) {
+            *errorString = file.errorString();
+            return false;
+        }
+        const qint64 total = file.size();
+#if defined(POSIX_FADV_SEQUENTIAL)
+        // Widens the readahead window of the kernel
+        posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(Q_OS_MACOS)
+        ::fcntl(file.handle(), F_RDAHEAD, 1);
+#endif
+
+        QByteArray buffer(std::clamp(total, qint64(1), chunkSize), Qt::Uninitialized);
+        for (qint64 offset = 0;;) {
+            if (cancelled.load(std::memory_order_relaxed)) {
+                *errorString = FileLocker::tr("The read has been cancelled");
+                return false;
+            }
+            const qint64 n = file.read(buffer.data(), buffer.size());
+            if (n < 0) {
+                *errorString = file.errorString();
+                return false;
+            }
+            if (n == 0) {
+                return true;
+            }
+            offset += n;
+#if defined(POSIX_FADV_WILLNEED)
+            // The next chunk is read from the disk while this one is consumed
+            posix_fadvise(file.handle(), offset, buffer.size(), POSIX_FADV_WILLNEED);
+#endif
+            if (!consumer({buffer.constData(), n}, total)) {
+                *errorString = FileLocker::tr("The read has been cancelled");
+                return false;
+            }
+        }
+    }
+
+    static std::optional<quint64> hashFile(const QString &filePath) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return {};
+        }
+        const qint64 size = file.size();
+        if (size == 0) {
+            return xxHash64({});
+        }
+        if (const uchar *address = file.map(0, size)) {
+            return xxHash64({address, size});
+        }
+        const QByteArray data = file.readAll();
+        if (file.error() != QFile::NoError) {
+            return {};
+        }
+        return xxHash64(data);
+    }
+
+    /*!
+        \class FileLockerMapping
+        \brief Read-only memory-mapped view of the file held by a FileLocker.
+
+        The view stays valid until the mapping is reset or destroyed, even if the locker is
+        closed. FileLocker refuses to overwrite the file in place while a mapping is alive.
+    */
+
+    FileLockerMapping::FileLockerMapping() : m_address(nullptr), m_size(0) {
+    }
+
+    FileLockerMapping::FileLockerMapping(FileLockerMapping &&other) noexcept
+        : m_file(std::move(other.m_file)), m_address(std::exchange(other.m_address, nullptr)),
+          m_size(std::exchange(other.m_size, 0)), m_counter(std::move(other.m_counter)) {
+    }
+
+    FileLockerMapping &FileLockerMapping::operator=(FileLockerMapping &&other) noexcept {
+        if (this != &other) {
+            reset();
+            m_file = std::move(other.m_file);
+            m_address = std::exchange(other.m_address, nullptr);
+            m_size = std::exchange(other.m_size, 0);
+            m_counter = std::move(other.m_counter);
+        }
+        return *this;
+    }
+
+    FileLockerMapping::~FileLockerMapping() {
+        reset();
+    }
+
+    bool FileLockerMapping::isValid() const {
+        return m_counter != nullptr;
+    }
+
+    QByteArrayView FileLockerMapping::data() const {
+        return {m_address, m_size};
+    }
+
+    qint64 FileLockerMapping::size() const {
+        return m_size;
+    }
+
+    void FileLockerMapping::reset() {
+        if (m_file && m_address) {
+            m_file->unmap(const_cast<uchar *>(m_address));
+        }
+        m_file.reset();
+        m_address = nullptr;
+        m_size = 0;
+        if (m_counter) {
+            m_counter->fetch_sub(1);
+            m_counter.reset();
+        }
+    }
+
     FileLocker::FileLocker(QObject *parent)
         : QObject(parent), d_ptr(new FileLockerPrivate) {
         Q_D(FileLocker);
         d->q_ptr = this;
         d->watcher = new QFileSystemWatcher(this);
+        d->savePool.setMaxThreadCount(1);
+
+        d->changeTimer = new QTimer(this);
+        d->changeTimer->setSingleShot(true);
+        d->changeTimer->setInterval(CHANGE_DEBOUNCE_INTERVAL);
+        connect(d->changeTimer, &QTimer::timeout, this, [d] { d->checkExternalChange(); });
         
         // Connect file system watcher signal
-        connect(d->watcher, &QFileSystemWatcher::fileChanged, this, [this](const QString &path) {
-            Q_D(FileLocker);
-            Q_UNUSED(path)
-            qCDebug(lcFileLocker) << "File" << d->filePath << "has been changed externally";
-            if (!d->isFileModifiedSinceLastSave) {
-                d->isFileModifiedSinceLastSave = true;
-                Q_EMIT fileModifiedSinceLastSaveChanged();
-            }
-        });
+        connect(d->watcher, &QFileSystemWatcher::fileChanged, d->changeTimer,
+                qOverload<>(&QTimer::start));
     }
 
     FileLocker::~FileLocker() {
         Q_D(FileLocker);
-
+        d->readCancelled = true;
+        d->waitForAsyncSave();
     }
 
     QString FileLocker::path() const {
@@ -56,11 +262,15 @@ namespace Core {
 
     bool FileLocker::open(const QString &path) {
         Q_D(FileLocker);
+        d->readCancelled = true;
+        d->waitForAsyncSave();
+        d->rollbackWriter();
         
         // Close current file if open
         if (d->file && d->file->isOpen()) {
             d->file->close();
         }
+        d->setLock(nullptr);
         
         // Remove previous file from watcher
         if (!d->filePath.isEmpty() && d->watcher->files().contains(d->filePath)) {
@@ -86,11 +296,25 @@ namespace Core {
             return false;
         }
         
-        // Update file path
+        // Writers lock exclusively. If another process holds the file, it can still be read but
+        // saving is refused until the lock is acquired.
+        auto lock = std::make_unique<AdvisoryLock>(path);
+        if (!((d->file->openMode() & QIODevice::WriteOnly) &&
+              d->tryLock(lock.get(), ExclusiveLock) == AdvisoryLock::Locked) &&
+            d->tryLock(lock.get(), SharedLock) != AdvisoryLock::Locked) {
+            qCInfo(lcFileLocker) << "Opened file without lock:" << path << d->errorString;
+            d->errorString.clear();
+        }
+        d->setLock(std::move(lock));
+
+        // Update file path, mappings of the previous file don't block saving this one
         d->filePath = path;
+        d->mappingCount = std::make_shared<std::atomic_int>(0);
         
         // Add to file system watcher
         d->watcher->addPath(path);
+        d->recordContent({});
+        d->loadJournal();
         
         // Reset modification flag
         if (d->isFileModifiedSinceLastSave) {
@@ -104,8 +328,74 @@ namespace Core {
         return true;
     }
 
+    /*!
+        Maps the whole file read-only without copying it. The mapping uses its own file handle
+        and is advised for sequential access.
+    */
+    FileLockerMapping FileLocker::map(bool *ok) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        if (ok) {
+            *ok = false;
+        }
+
+        d->errorString.clear();
+
+        if (!d->file || !d->file->isOpen()) {
+            qCWarning(lcFileLocker) << "Attempted to map data when no file is open";
+            return {};
+        }
+
+        // The image alone is not the document
+        if (d->journal && !d->journal->isEmpty()) {
+            d->errorString = tr("The file has incremental saves that are not compacted");
+            qCWarning(lcFileLocker) << "Attempted to map a file with a journal";
+            return {};
+        }
+
+        auto file = std::make_unique<QFile>(d->filePath);
+        if (!file->open(QIODevice::ReadOnly | QIODevice::ExistingOnly)) {
+            d->errorString = file->errorString();
+            qCWarning(lcFileLocker) << "Failed to open file for mapping:" << d->errorString;
+            return {};
+        }
+
+        FileLockerMapping mapping;
+        const qint64 size = file->size();
+        if (size > 0) {
+            uchar *address = file->map(0, size);
+            if (!address) {
+                d->errorString = file->errorString();
+                qCWarning(lcFileLocker) << "Failed to map file:" << d->errorString;
+                return {};
+            }
+#ifdef Q_OS_UNIX
+            posix_madvise(address, size_t(size), POSIX_MADV_SEQUENTIAL);
+#endif
+            mapping.m_address = address;
+            mapping.m_size = size;
+        }
+        mapping.m_file = std::move(file);
+        mapping.m_counter = d->mappingCount;
+        mapping.m_counter->fetch_add(1);
+
+        if (ok) {
+            *ok = true;
+        }
+
+        qCDebug(lcFileLocker) << "Successfully mapped" << size << "bytes from file";
+        return mapping;
+    }
+
+    /*!
+        Reads the whole document. The file is read in chunks of readChunkSize(), readProgress()
+        is emitted after each one and cancelRead() stops the read.
+    */
     QByteArray FileLocker::readData(bool *ok) {
         Q_D(FileLocker);
+        d->waitForAsyncSave();
+        d->readCancelled = false;
         
         if (ok) {
             *ok = false;
@@ -117,23 +407,53 @@ namespace Core {
             qCWarning(lcFileLocker) << "Attempted to read data when no file is open";
             return {};
         }
-        
-        // Save current position
-        qint64 originalPos = d->file->pos();
-        
-        // Seek to beginning
-        if (!d->file->seek(0)) {
-            d->errorString = d->file->errorString();
-            qCWarning(lcFileLocker) << "Failed to seek to beginning of file:" << d->errorString;
-            return {};
+
+        const bool hasJournal = d->journal && !d->journal->isEmpty();
+
+        // Copy from a mapping, falls back to reading if the file system cannot map
+        QByteArray data;
+        bool mapped = false;
+        if (!hasJournal) {
+            if (auto mapping = map(); mapping.isValid()) {
+                const auto view = mapping.data();
+                data.resize(view.size());
+                for (qsizetype offset = 0; offset < view.size(); offset += d->readChunkSize) {
+                    if (d->readCancelled.load(std::memory_order_relaxed)) {
+                        d->errorString = tr("The read has been cancelled");
+                        qCInfo(lcFileLocker) << "Read of" << d->filePath << "cancelled";
+                        return {};
+                    }
+                    const auto chunk = view.sliced(offset, std::min(qsizetype(d->readChunkSize),
+                                                                    view.size() - offset));
+                    std::memcpy(data.data() + offset, chunk.data(), size_t(chunk.size()));
+                    Q_EMIT readProgress(offset + chunk.size(), view.size());
+                }
+                mapped = true;
+            }
+            d->errorString.clear();
         }
-        
-        // Read all data
-        QByteArray data = d->file->readAll();
-        if (d->file->error() != QFile::NoError) {
-            d->errorString = d->file->errorString();
-            qCWarning(lcFileLocker) << "Failed to read file data:" << d->errorString;
-            return {};
+
+        if (!mapped) {
+            qint64 bytesRead = 0;
+            auto append = [&](QByteArrayView chunk, qint64 total) {
+                if (data.isEmpty()) {
+                    data.reserve(total);
+                }
+                data.append(chunk);
+                bytesRead += chunk.size();
+                Q_EMIT readProgress(bytesRead, total);
+                return true;
+            };
+            if (!readInChunks(d->filePath, d->readChunkSize, d->readCancelled, append,
+                              &d->errorString)) {
+                qCWarning(lcFileLocker) << "Failed to read file data:" << d->errorString;
+                return {};
+            }
+        }
+        d->recordContent(xxHash64(data));
+
+        if (hasJournal) {
+            d->journal->replay(data);
         }
         
         if (ok) {
@@ -144,8 +464,180 @@ namespace Core {
         return data;
     }
 
+    /*!
+        Reads the document sequentially and passes it to \a consumer in chunks of
+        readChunkSize(), without holding the whole document in memory. The consumer returns
+        \c false to stop. readProgress() is emitted after each chunk and cancelRead() stops
+        the read, in both cases \c false is returned.
+    */
+    bool FileLocker::readChunks(const std::function<bool(QByteArrayView chunk)> &consumer) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+        d->readCancelled = false;
+
+        d->errorString.clear();
+
+        if (!d->file || !d->file->isOpen()) {
+            qCWarning(lcFileLocker) << "Attempted to read data when no file is open";
+            return false;
+        }
+
+        qint64 bytesRead = 0;
+        auto feed = [&](QByteArrayView chunk, qint64 total) {
+            if (!consumer(chunk)) {
+                return false;
+            }
+            bytesRead += chunk.size();
+            Q_EMIT readProgress(bytesRead, total);
+            return true;
+        };
+
+        // The journal is applied to each chunk of the image
+        if (d->journal && !d->journal->isEmpty()) {
+            QFile image(d->filePath);
+            if (!image.open(QIODevice::ReadOnly | QIODevice::ExistingOnly |
+                            QIODevice::Unbuffered)) {
+                d->errorString = image.errorString();
+                qCWarning(lcFileLocker) << "Failed to read file data:" << d->errorString;
+                return false;
+            }
+            const qint64 total = d->journal->size();
+            QByteArray chunk;
+            for (qint64 offset = 0; offset < total; offset += chunk.size()) {
+                if (d->readCancelled.load(std::memory_order_relaxed)) {
+                    d->errorString = tr("The read has been cancelled");
+                    return false;
+                }
+                chunk.resize(std::min(d->readChunkSize, total - offset));
+                const qint64 n = image.read(chunk.data(), chunk.size());
+                if (n < 0) {
+                    d->errorString = image.errorString();
+                    qCWarning(lcFileLocker) << "Failed to read file data:" << d->errorString;
+                    return false;
+                }
+                std::memset(chunk.data() + n, 0, size_t(chunk.size() - n));
+                d->journal->replayRange(offset, chunk);
+                if (!feed(chunk, total)) {
+                    d->errorString = tr("The read has been cancelled");
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        if (!readInChunks(d->filePath, d->readChunkSize, d->readCancelled, feed,
+                          &d->errorString)) {
+            qCInfo(lcFileLocker) << "Chunked read of" << d->filePath
+                                 << "stopped:" << d->errorString;
+            return false;
+        }
+        return true;
+    }
+
+    /*!
+        Reads the document on a worker thread and returns immediately. readProgress() is
+        emitted while reading, then readFinished() with the document or readFailed().
+        cancelRead() stops the read. Only one read runs at a time.
+    */
+    bool FileLocker::readDataAsync() {
+        Q_D(FileLocker);
+
+        d->errorString.clear();
+
+        if (!d->file || !d->file->isOpen()) {
+            qCWarning(lcFileLocker) << "Attempted to read data when no file is open";
+            return false;
+        }
+
+        if (d->asyncRead) {
+            d->errorString = tr("Another read is in progress");
+            qCWarning(lcFileLocker) << "Attempted to read while another read is in progress";
+            return false;
+        }
+
+        d->readCancelled = false;
+
+        auto job = std::make_shared<AsyncReadJob>();
+        job->path = d->filePath;
+        job->chunkSize = d->readChunkSize;
+        d->asyncRead = job;
+
+        // Shares the worker of the saves, so reads and writes of the file never overlap
+        d->savePool.start([d, this, job]() {
+            qint64 bytesRead = 0;
+            auto append = [&](QByteArrayView chunk, qint64 total) {
+                if (job->data.isEmpty()) {
+                    job->data.reserve(total);
+                }
+                job->data.append(chunk);
+                bytesRead += chunk.size();
+                QMetaObject::invokeMethod(
+                    this, [this, bytesRead, total]() { Q_EMIT readProgress(bytesRead, total); },
+                    Qt::QueuedConnection);
+                return true;
+            };
+            job->ok = readInChunks(job->path, job->chunkSize, d->readCancelled, append,
+                                   &job->errorString);
+            if (job->ok) {
+                job->hash = xxHash64(job->data);
+            }
+            QMetaObject::invokeMethod(
+                this, [d, job]() { d->finishAsyncRead(job); }, Qt::QueuedConnection);
+        });
+        return true;
+    }
+
+    /*!
+        Stops the running read of readData(), readChunks() or readDataAsync(). Can be called
+        from any thread.
+    */
+    void FileLocker::cancelRead() {
+        Q_D(FileLocker);
+        d->readCancelled = true;
+    }
+
+    qint64 FileLocker::readChunkSize() const {
+        Q_D(const FileLocker);
+        return d->readChunkSize;
+    }
+
+    void FileLocker::setReadChunkSize(qint64 bytes) {
+        Q_D(FileLocker);
+        d->readChunkSize = std::max(bytes, qint64(4096));
+    }
+
+    void FileLockerPrivate::finishAsyncRead(const std::shared_ptr<AsyncReadJob> &job) {
+        Q_Q(FileLocker);
+
+        // Already finished by waitForAsyncSave()
+        if (job != asyncRead) {
+            return;
+        }
+        asyncRead.reset();
+
+        if (!job->ok) {
+            errorString = job->errorString;
+            qCWarning(lcFileLocker) << "Failed to read asynchronously:" << errorString;
+            Q_EMIT q->readFailed(errorString);
+            return;
+        }
+
+        // The base read by the worker is the current image, synchronous operations wait for it
+        if (job->path == filePath) {
+            recordContent(job->hash);
+            if (journal && !journal->isEmpty()) {
+                journal->replay(job->data);
+            }
+        }
+        qCDebug(lcFileLocker) << "Successfully read" << job->data.size() << "bytes from file";
+        Q_EMIT q->readFinished(job->data);
+    }
+
     void FileLocker::release() {
         Q_D(FileLocker);
+        d->readCancelled = true;
+        d->waitForAsyncSave();
+        d->rollbackWriter();
         
         if (d->file && d->file->isOpen()) {
             d->file->close();
@@ -154,6 +646,7 @@ namespace Core {
         
         // Keep the file path but reset the file object
         d->file.reset();
+        d->setLock(nullptr);
         
         // Clear error string
         d->errorString.clear();
@@ -161,6 +654,7 @@ namespace Core {
 
     bool FileLocker::save(const QByteArray &data) {
         Q_D(FileLocker);
+        d->waitForAsyncSave();
 
         d->errorString.clear();
         
@@ -169,38 +663,39 @@ namespace Core {
             return false;
         }
 
-        auto reAddPath = [&](void *) {
-            d->watcher->addPath(d->filePath);
-        };
-        std::unique_ptr<void, decltype(reAddPath)> guard(this, reAddPath);
-        d->watcher->removePath(d->filePath);
-        
+        if (d->isWriting() || !d->lockForWriting(d->filePath)) {
+            return false;
+        }
+
+        if (d->saveMode == Atomic) {
+            QSaveFile saveFile(d->filePath);
+            if (saveFile.open(QIODevice::WriteOnly)) {
+                if (saveFile.write(data) != data.size()) {
+                    d->errorString = saveFile.errorString();
+                    qCWarning(lcFileLocker) << "Failed to write data:" << d->errorString;
+                    saveFile.cancelWriting();
+                    return false;
+                }
+                return d->commitWriter(&saveFile, d->filePath, false, data.size(),
+                                       xxHash64(data));
+            }
+            // Typically the directory is not writable, the file itself may still be
+            qCInfo(lcFileLocker) << "Cannot create temporary file, saving in place:"
+                                 << saveFile.errorString();
+        }
+
+        // Writing in place would change the contents under the mapped views
+        if (d->mappingCount->load() > 0) {
+            d->errorString = tr("The file is still mapped for reading");
+            qCWarning(lcFileLocker) << "Attempted to save while the file is mapped";
+            return false;
+        }
+
         if (d->file && d->file->isOpen()) {
             // File is open, check if we can write
             if (d->file->openMode() & QIODevice::WriteOnly) {
                 // File is writable, write directly
-                if (!d->file->seek(0)) {
-                    d->errorString = d->file->errorString();
-                    qCWarning(lcFileLocker) << "Failed to seek to beginning for save:" << d->errorString;
-                    return false;
-                }
-                
-                if (d->file->write(data) != data.size()) {
-                    d->errorString = d->file->errorString();
-                    qCWarning(lcFileLocker) << "Failed to write data:" << d->errorString;
-                    return false;
-                }
-                
-                // Truncate file at current position
-                if (!d->file->resize(d->file->pos())) {
-                    d->errorString = d->file->errorString();
-                    qCWarning(lcFileLocker) << "Failed to resize file:" << d->errorString;
-                    return false;
-                }
-                
-                if (!d->file->flush()) {
-                    d->errorString = d->file->errorString();
-                    qCWarning(lcFileLocker) << "Failed to flush file:" << d->errorString;
+                if (!writeInPlace(d->file.get(), data, &d->errorString)) {
                     return false;
                 }
             } else {
@@ -214,27 +709,7 @@ namespace Core {
                     return false;
                 }
 
-                if (!tempFile->seek(0)) {
-                    d->errorString = tempFile->errorString();
-                    qCWarning(lcFileLocker) << "Failed to seek after reopen:" << d->errorString;
-                    return false;
-                }
-
-                if (tempFile->write(data) != data.size()) {
-                    d->errorString = tempFile->errorString();
-                    qCWarning(lcFileLocker) << "Failed to write after reopen:" << d->errorString;
-                    return false;
-                }
-
-                if (!tempFile->resize(tempFile->pos())) {
-                    d->errorString = tempFile->errorString();
-                    qCWarning(lcFileLocker) << "Failed to resize after reopen:" << d->errorString;
-                    return false;
-                }
-
-                if (!tempFile->flush()) {
-                    d->errorString = tempFile->errorString();
-                    qCWarning(lcFileLocker) << "Failed to flush after reopen:" << d->errorString;
+                if (!writeInPlace(tempFile.get(), data, &d->errorString)) {
                     return false;
                 }
 
@@ -249,26 +724,14 @@ namespace Core {
                 return false;
             }
             
-            if (tempFile.write(data) != data.size()) {
-                d->errorString = tempFile.errorString();
-                qCWarning(lcFileLocker) << "Failed to write data to file:" << d->errorString;
-                return false;
-            }
-
-            if (!tempFile.resize(tempFile.pos())) {
-                d->errorString = tempFile.errorString();
-                qCWarning(lcFileLocker) << "Failed to resize after reopen:" << d->errorString;
-                return false;
-            }
-            
-            if (!tempFile.flush()) {
-                d->errorString = tempFile.errorString();
-                qCWarning(lcFileLocker) << "Failed to flush temporary file:" << d->errorString;
+            if (!writeInPlace(&tempFile, data, &d->errorString)) {
                 return false;
             }
             
             tempFile.close();
         }
+        d->recordContent(xxHash64(data));
+        d->discardJournal();
         
         // Reset modification flag after successful save
         if (d->isFileModifiedSinceLastSave) {
@@ -282,6 +745,7 @@ namespace Core {
 
     bool FileLocker::saveAs(const QString &path, const QByteArray &data) {
         Q_D(FileLocker);
+        d->waitForAsyncSave();
 
         d->errorString.clear();
         
@@ -289,6 +753,35 @@ namespace Core {
             qCWarning(lcFileLocker) << "Attempted saveAs with empty path";
             return false;
         }
+
+        if (d->isWriting() || !d->lockForWriting(path)) {
+            return false;
+        }
+
+        if (d->saveMode == Atomic) {
+            QSaveFile saveFile(path);
+            if (saveFile.open(QIODevice::WriteOnly)) {
+                if (saveFile.write(data) != data.size()) {
+                    d->errorString = saveFile.errorString();
+                    qCWarning(lcFileLocker)
+                        << "Failed to write data during saveAs:" << d->errorString;
+                    saveFile.cancelWriting();
+                    d->pendingLock.reset();
+                    return false;
+                }
+                return d->commitWriter(&saveFile, path, true, data.size(), xxHash64(data));
+            }
+            qCInfo(lcFileLocker) << "Cannot create temporary file, saving in place:"
+                                 << saveFile.errorString();
+        }
+
+        // Writing the current file in place would change the contents under the mapped views
+        if (QFileInfo(path) == QFileInfo(d->filePath) && d->mappingCount->load() > 0) {
+            d->errorString = tr("The file is still mapped for reading");
+            qCWarning(lcFileLocker) << "Attempted to save while the file is mapped";
+            d->pendingLock.reset();
+            return false;
+        }
         
         // Create a new file for the saveAs operation
         auto newFile = std::make_unique<QFile>(path);
@@ -296,26 +789,13 @@ namespace Core {
         if (!newFile->open(QIODevice::ReadWrite)) {
             d->errorString = newFile->errorString();
             qCWarning(lcFileLocker) << "Failed to open file for saveAs:" << path << "Error:" << d->errorString;
+            d->pendingLock.reset();
             return false;
         }
 
-        if (newFile->write(data) != data.size()) {
-            d->errorString = newFile->errorString();
-            qCWarning(lcFileLocker) << "Failed to write data during saveAs:" << d->errorString;
-            newFile->close();
-            return false;
-        }
-
-        if (!newFile->resize(newFile->pos())) {
-            d->errorString = newFile->errorString();
-            qCWarning(lcFileLocker) << "Failed to resize after reopen:" << d->errorString;
-            return false;
-        }
-        
-        if (!newFile->flush()) {
-            d->errorString = newFile->errorString();
-            qCWarning(lcFileLocker) << "Failed to flush during saveAs:" << d->errorString;
+        if (!writeInPlace(newFile.get(), data, &d->errorString)) {
             newFile->close();
+            d->pendingLock.reset();
             return false;
         }
         
@@ -326,11 +806,16 @@ namespace Core {
         
         // Replace current file with the new one
         d->file = std::move(newFile);
+        if (path != d->filePath) {
+            d->setLock(std::move(d->pendingLock));
+        }
         d->filePath = path;
+        d->mappingCount = std::make_shared<std::atomic_int>(0);
         
         // Add new file to watcher
-        // FIXME macOS watcher erroneously detects the change made by this program itself
         d->watcher->addPath(path);
+        d->recordContent(xxHash64(data));
+        d->discardJournal();
         
         // Reset modification flag after successful saveAs
         if (d->isFileModifiedSinceLastSave) {
@@ -345,15 +830,713 @@ namespace Core {
         return true;
     }
 
+    FileLocker::SaveMode FileLocker::saveMode() const {
+        Q_D(const FileLocker);
+        return d->saveMode;
+    }
+
+    /*!
+        Sets how save() and saveAs() write the file. \c Atomic writes a temporary file next to
+        the target, syncs it, renames it over the target and syncs the directory, so a crash
+        leaves either the old or the new document. It falls back to \c InPlace when the
+        temporary file cannot be created. \c InPlace overwrites and syncs the file itself and
+        keeps its identity, such as hard links and ownership.
+
+        Streaming saves with beginSave() are always atomic.
+    */
+    void FileLocker::setSaveMode(SaveMode mode) {
+        Q_D(FileLocker);
+        if (d->saveMode == mode) {
+            return;
+        }
+        d->saveMode = mode;
+        Q_EMIT saveModeChanged();
+    }
+
+    /*!
+        Starts a streaming save to the current file. Data written to the returned writer reaches
+        the file on FileLockerWriter::commit(). Only one writer can be active at a time, and no
+        other save is accepted until it commits or rolls back. The writer is a child of the
+        locker and may be deleted once it is finished.
+    */
+    FileLockerWriter *FileLocker::beginSave() {
+        Q_D(FileLocker);
+
+        d->errorString.clear();
+
+        if (d->filePath.isEmpty()) {
+            qCWarning(lcFileLocker) << "Attempted to save when no file path is set";
+            return nullptr;
+        }
+        return createWriter(d->filePath, false);
+    }
+
+    /*!
+        Starts a streaming save to \a path, the locker switches to it on commit.
+    */
+    FileLockerWriter *FileLocker::beginSaveAs(const QString &path) {
+        Q_D(FileLocker);
+
+        d->errorString.clear();
+
+        if (path.isEmpty()) {
+            qCWarning(lcFileLocker) << "Attempted saveAs with empty path";
+            return nullptr;
+        }
+        return createWriter(path, true);
+    }
+
+    FileLockerWriter *FileLocker::createWriter(const QString &path, bool saveAs) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        if (d->isWriting() || !d->lockForWriting(path)) {
+            return nullptr;
+        }
+
+        auto writer = new FileLockerWriter(this, d, path, saveAs);
+        if (!writer->isOpen()) {
+            d->errorString = writer->errorString();
+            delete writer;
+            d->pendingLock.reset();
+            return nullptr;
+        }
+        d->writer = writer;
+        return writer;
+    }
+
+    // A streaming save excludes every other save until it commits or rolls back
+    bool FileLockerPrivate::isWriting() {
+        if (!writer) {
+            return false;
+        }
+        errorString = FileLocker::tr("Another save is in progress");
+        qCWarning(lcFileLocker) << "Attempted to save while another save is in progress";
+        return true;
+    }
+
+    // The writer targets the file held when the save began, it cannot outlive a switch to
+    // another one
+    void FileLockerPrivate::rollbackWriter() {
+        if (writer) {
+            qCWarning(lcFileLocker) << "Rolling back the save in progress to" << writer->fileName();
+            writer->rollback();
+        }
+    }
+
+    bool FileLockerPrivate::commitWriter(QSaveFile *saveFile, const QString &path, bool saveAs,
+                                         qint64 size, std::optional<quint64> hash, bool synced) {
+        Q_Q(FileLocker);
+
+        errorString.clear();
+
+        // A save of the current file must not bring back a file the locker no longer holds
+        if (!saveAs && path != filePath) {
+            errorString = FileLocker::tr("The file has been closed since the save began");
+            qCWarning(lcFileLocker) << "Rejected a save to" << path
+                                    << "which is no longer the current file";
+            return false;
+        }
+
+        // The save file only fsync()s before the rename, which doesn't reach the drive on every
+        // platform. Asynchronous saves sync on the worker thread
+        if (!synced && !syncFile(saveFile)) {
+            errorString = saveFile->errorString();
+            qCWarning(lcFileLocker) << "Failed to sync save to" << path << "Error:" << errorString;
+            pendingLock.reset();
+            return false;
+        }
+
+#ifdef Q_OS_WINDOWS
+        // A file that is open cannot be replaced
+        const bool reopenOnFailure = file && file->fileName() == path;
+        if (reopenOnFailure) {
+            file.reset();
+        }
+#endif
+
+        if (!saveFile->commit()) {
+            errorString = saveFile->errorString();
+            qCWarning(lcFileLocker) << "Failed to commit save to" << path
+                                    << "Error:" << errorString;
+#ifdef Q_OS_WINDOWS
+            if (reopenOnFailure) {
+                file = std::make_unique<QFile>(path);
+                if (!file->open(QIODevice::ReadWrite | QIODevice::ExistingOnly) &&
+                    !file->open(QIODevice::ReadOnly | QIODevice::ExistingOnly)) {
+                    file.reset();
+                }
+            }
+#endif
+            pendingLock.reset();
+            return false;
+        }
+
+        if (!syncDirectory(path)) {
+            qCWarning(lcFileLocker) << "Failed to sync the directory of" << path;
+        }
+
+        // The previous handle refers to the replaced file, hold the new one
+        auto newFile = std::make_unique<QFile>(path);
+        if (newFile->open(QIODevice::ReadWrite | QIODevice::ExistingOnly) ||
+            newFile->open(QIODevice::ReadOnly | QIODevice::ExistingOnly)) {
+            file = std::move(newFile);
+        } else {
+            qCWarning(lcFileLocker) << "Saved file could not be reopened:" << path
+                                    << "Error:" << newFile->errorString();
+            file.reset();
+        }
+
+        // The watch follows the replaced file, move it to the new one
+        if (!filePath.isEmpty()) {
+            watcher->removePath(filePath);
+        }
+
+        const bool pathChanged = saveAs && path != filePath;
+        filePath = path;
+        if (pathChanged) {
+            mappingCount = std::make_shared<std::atomic_int>(0);
+            setLock(std::move(pendingLock));
+        }
+        watcher->addPath(path);
+        recordContent(hash);
+        discardJournal();
+
+        if (isFileModifiedSinceLastSave) {
+            isFileModifiedSinceLastSave = false;
+            Q_EMIT q->fileModifiedSinceLastSaveChanged();
+        }
+        if (pathChanged) {
+            Q_EMIT q->pathChanged();
+            Q_EMIT q->entryNameChanged();
+        }
+
+        qCDebug(lcFileLocker) << "Successfully saved" << size << "bytes to file:" << path;
+        return true;
+    }
+
+    /*!
+        Saves \a data on a worker thread and returns immediately. The buffer is shared, not
+        copied, so the caller should not modify it afterwards. saveFinished() or saveFailed()
+        is emitted when the save completes.
+
+        Saves run one at a time. A save requested while another one is running replaces any
+        save that has not started yet. Synchronous operations wait for the running saves.
+    */
+    bool FileLocker::saveAsync(QByteArray data) {
+        Q_D(FileLocker);
+
+        d->errorString.clear();
+
+        if (d->filePath.isEmpty()) {
+            qCWarning(lcFileLocker) << "Attempted to save when no file path is set";
+            return false;
+        }
+
+        if (d->isWriting() || !d->lockForWriting(d->filePath)) {
+            return false;
+        }
+
+        if (d->asyncSave) {
+            d->queuedSaveData = std::move(data);
+            return true;
+        }
+        return d->startAsyncSave(std::move(data));
+    }
+
+    bool FileLocker::isSaving() const {
+        Q_D(const FileLocker);
+        return d->asyncSave != nullptr;
+    }
+
+    /*!
+        Saves only the changed byte ranges of the document. \a patches are appended to a
+        \c .journal sidecar and synced, the file itself is left untouched. \a size is the new
+        size of the document, by default it grows to cover the patches.
+
+        readData() replays the journal on top of the file, open() checks that the journal
+        belongs to the file and drops it otherwise. The journal is compacted into a full save
+        when it outgrows the document or the compaction threshold, and is superseded by any
+        full save. map() is refused until then.
+    */
+    bool FileLocker::saveIncremental(const QList<Patch> &patches, qint64 size) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        d->errorString.clear();
+
+        if (d->filePath.isEmpty()) {
+            qCWarning(lcFileLocker) << "Attempted to save when no file path is set";
+            return false;
+        }
+
+        if (d->isWriting() || !d->lockForWriting(d->filePath)) {
+            return false;
+        }
+
+        if (!d->journal) {
+            d->journal = std::make_unique<FileLockerJournal>(d->filePath);
+        }
+        auto &journal = *d->journal;
+
+        // The first record pins the image it applies to
+        qint64 baseSize = journal.baseSize();
+        quint64 baseHash = journal.baseHash();
+        if (journal.isEmpty()) {
+            const QFileInfo info(d->filePath);
+            baseSize = info.size();
+            if (d->content.hash && d->content.size == baseSize &&
+                d->content.lastModified == info.lastModified()) {
+                baseHash = *d->content.hash;
+            } else if (const auto hash = hashFile(d->filePath)) {
+                baseHash = *hash;
+            } else {
+                d->errorString = tr("Failed to read the file");
+                qCWarning(lcFileLocker) << "Failed to hash the image of" << d->filePath;
+                return false;
+            }
+        }
+
+        const qint64 currentSize = journal.isEmpty() ? baseSize : journal.size();
+        if (size < 0) {
+            size = currentSize;
+            for (const auto &patch : patches) {
+                size = std::max(size, patch.offset + patch.data.size());
+            }
+        }
+        for (const auto &patch : patches) {
+            if (patch.offset < 0 || patch.offset + patch.data.size() > size) {
+                d->errorString = tr("The patch is out of the range of the document");
+                qCWarning(lcFileLocker) << "Invalid patch at" << patch.offset;
+                return false;
+            }
+        }
+
+        if (!journal.append({size, patches}, baseSize, baseHash, &d->errorString)) {
+            qCWarning(lcFileLocker) << "Failed to append to the journal:" << d->errorString;
+            return false;
+        }
+
+        if (d->isFileModifiedSinceLastSave) {
+            d->isFileModifiedSinceLastSave = false;
+            Q_EMIT fileModifiedSinceLastSaveChanged();
+        }
+
+        qCDebug(lcFileLocker) << "Saved" << patches.size() << "patches to the journal of"
+                              << d->filePath;
+
+        // Replaying costs more than rewriting once the journal outgrows the image
+        const qint64 threshold = std::min(d->journalCompactionThreshold,
+                                          std::max(journal.baseSize(), MIN_COMPACTION_THRESHOLD));
+        if (journal.byteSize() > threshold && !compactJournal()) {
+            // The incremental save itself has succeeded
+            qCWarning(lcFileLocker) << "Failed to compact the journal:" << d->errorString;
+            d->errorString.clear();
+        }
+        return true;
+    }
+
+    /*!
+        Saves \a data appended to the end of the document, see saveIncremental().
+    */
+    bool FileLocker::saveAppend(const QByteArray &data) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        const qint64 offset = d->journal && !d->journal->isEmpty()
+                                  ? d->journal->size()
+                                  : QFileInfo(d->filePath).size();
+        return saveIncremental({{offset, data}});
+    }
+
+    /*!
+        Writes the document with the journal applied as a full image and removes the journal.
+        The image is written according to saveMode().
+    */
+    bool FileLocker::compactJournal() {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        if (!d->journal || d->journal->isEmpty()) {
+            return true;
+        }
+
+        bool ok;
+        const QByteArray data = readData(&ok);
+        if (!ok) {
+            return false;
+        }
+        qCDebug(lcFileLocker) << "Compacting the journal of" << d->filePath;
+        return save(data);
+    }
+
+    qint64 FileLocker::journalSize() const {
+        Q_D(const FileLocker);
+        return d->journal && !d->journal->isEmpty() ? d->journal->byteSize() : 0;
+    }
+
+    qint64 FileLocker::journalCompactionThreshold() const {
+        Q_D(const FileLocker);
+        return d->journalCompactionThreshold;
+    }
+
+    void FileLocker::setJournalCompactionThreshold(qint64 bytes) {
+        Q_D(FileLocker);
+        d->journalCompactionThreshold = bytes;
+    }
+
+    // Runs on the worker thread, only touches the job
+    static void runAsyncSave(AsyncSaveJob *job) {
+        job->hash = xxHash64(job->data);
+
+        if (job->mode == FileLocker::Atomic) {
+            auto saveFile = std::make_unique<QSaveFile>(job->path);
+            if (saveFile->open(QIODevice::WriteOnly)) {
+                // Sync here, the commit on the locker's thread then only renames
+                if (saveFile->write(job->data) != job->data.size() || !syncFile(saveFile.get())) {
+                    job->errorString = saveFile->errorString();
+                    saveFile->cancelWriting();
+                    return;
+                }
+                saveFile->moveToThread(job->thread);
+                job->saveFile = std::move(saveFile);
+                job->ok = true;
+                return;
+            }
+        }
+
+        // Also when the temporary file could not be created, writing in place would change the
+        // contents under the mapped views
+        if (job->mappingCount->load() > 0) {
+            job->errorString = FileLocker::tr("The file is still mapped for reading");
+            return;
+        }
+
+        QFile file(job->path);
+        if (!file.open(QIODevice::ReadWrite)) {
+            job->errorString = file.errorString();
+            return;
+        }
+        job->ok = writeInPlace(&file, job->data, &job->errorString);
+    }
+
+    bool FileLockerPrivate::startAsyncSave(QByteArray data) {
+        Q_Q(FileLocker);
+
+        // In place writes would change the contents under the mapped views
+        if (saveMode == FileLocker::InPlace && mappingCount->load() > 0) {
+            errorString = FileLocker::tr("The file is still mapped for reading");
+            qCWarning(lcFileLocker) << "Attempted to save while the file is mapped";
+            return false;
+        }
+
+        auto job = std::make_shared<AsyncSaveJob>();
+        job->data = std::move(data);
+        job->path = filePath;
+        job->mode = saveMode;
+        job->thread = q->thread();
+        job->mappingCount = mappingCount;
+        asyncSave = job;
+
+        savePool.start([this, q, job]() {
+            runAsyncSave(job.get());
+            QMetaObject::invokeMethod(
+                q, [this, job]() { finishAsyncSave(job); }, Qt::QueuedConnection);
+        });
+        Q_EMIT q->savingChanged();
+        return true;
+    }
+
+    void FileLockerPrivate::finishAsyncSave(const std::shared_ptr<AsyncSaveJob> &job) {
+        Q_Q(FileLocker);
+
+        // Already finished by waitForAsyncSave()
+        if (job != asyncSave) {
+            return;
+        }
+        asyncSave.reset();
+
+        bool ok = job->ok;
+        if (ok && job->saveFile) {
+            ok = commitWriter(job->saveFile.get(), job->path, false, job->data.size(), job->hash,
+                              true);
+            job->saveFile.reset();
+        } else {
+            if (ok) {
+                recordContent(job->hash);
+                discardJournal();
+                if (isFileModifiedSinceLastSave) {
+                    isFileModifiedSinceLastSave = false;
+                    Q_EMIT q->fileModifiedSinceLastSaveChanged();
+                }
+                qCDebug(lcFileLocker) << "Successfully saved" << job->data.size()
+                                      << "bytes to file:" << job->path;
+            } else {
+                errorString = job->errorString;
+                qCWarning(lcFileLocker) << "Failed to save asynchronously:" << errorString;
+            }
+        }
+
+        if (ok) {
+            Q_EMIT q->saveFinished();
+        } else {
+            Q_EMIT q->saveFailed(errorString);
+        }
+
+        if (queuedSaveData) {
+            QByteArray data = std::move(*queuedSaveData);
+            queuedSaveData.reset();
+            if (startAsyncSave(std::move(data))) {
+                return;
+            }
+            Q_EMIT q->saveFailed(errorString);
+        }
+        Q_EMIT q->savingChanged();
+    }
+
+    void FileLockerPrivate::waitForAsyncSave() {
+        while (asyncSave || asyncRead) {
+            savePool.waitForDone();
+            if (auto job = asyncRead) {
+                finishAsyncRead(job);
+            }
+            if (auto job = asyncSave) {
+                finishAsyncSave(job);
+            }
+        }
+    }
+
+    FileLocker::LockMode FileLocker::lockMode() const {
+        Q_D(const FileLocker);
+        return d->lockMode();
+    }
+
+    /*!
+        Acquires an advisory lock of the current file without blocking. The lock is held on a
+        \c .lock sidecar next to the file, so it survives atomic saves and is released by the
+        OS if the process dies. Writers should hold \c ExclusiveLock, readers that need a stable
+        file \c SharedLock. A held lock can be converted to the other mode.
+
+        If another process holds a conflicting lock, returns \c false and fills \a owner with
+        the information the exclusive holder wrote into the sidecar. On file systems without
+        locks the owner information is checked instead, and treated as stale if the process
+        is gone or the lock is older than a day.
+
+        open() tries to lock the file, saves require \c ExclusiveLock and try to acquire it.
+    */
+    bool FileLocker::tryLock(LockMode mode, LockOwner *owner) {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+
+        d->errorString.clear();
+
+        if (d->filePath.isEmpty()) {
+            qCWarning(lcFileLocker) << "Attempted to lock when no file path is set";
+            return false;
+        }
+
+        if (!d->lock) {
+            d->lock = std::make_unique<AdvisoryLock>(d->filePath);
+        }
+        const bool ok = d->tryLock(d->lock.get(), mode) == AdvisoryLock::Locked;
+        if (owner) {
+            *owner = d->lockOwner;
+        }
+        return ok;
+    }
+
+    void FileLocker::unlock() {
+        Q_D(FileLocker);
+        d->waitForAsyncSave();
+        d->setLock(nullptr);
+    }
+
+    /*!
+        Returns the owner of the conflicting lock reported by the last failed lock attempt.
+    */
+    FileLocker::LockOwner FileLocker::lockOwner() const {
+        Q_D(const FileLocker);
+        return d->lockOwner;
+    }
+
+    FileLocker::LockMode FileLockerPrivate::lockMode() const {
+        return lock ? lock->mode() : FileLocker::Unlocked;
+    }
+
+    void FileLockerPrivate::setLock(std::unique_ptr<AdvisoryLock> newLock) {
+        Q_Q(FileLocker);
+        const auto previousMode = lockMode();
+        lock = std::move(newLock);
+        if (lockMode() != previousMode) {
+            Q_EMIT q->lockModeChanged();
+        }
+    }
+
+    AdvisoryLock::Result FileLockerPrivate::tryLock(AdvisoryLock *target,
+                                                    FileLocker::LockMode mode) {
+        Q_Q(FileLocker);
+
+        FileLocker::LockOwner owner;
+        QString error;
+        const auto previousMode = lockMode();
+        const auto result = target->tryLock(mode, &owner, &error);
+        if (lockMode() != previousMode) {
+            Q_EMIT q->lockModeChanged();
+        }
+
+        lockOwner = owner;
+        if (result == AdvisoryLock::Conflict && owner.pid > 0) {
+            errorString = FileLocker::tr("The file is locked by %1 (process %2 on %3)")
+                              .arg(owner.applicationName, QString::number(owner.pid),
+                                   owner.hostName);
+        } else if (result != AdvisoryLock::Locked) {
+            errorString = error;
+        }
+        return result;
+    }
+
+    // Makes sure that no other process holds the file that is going to be written
+    bool FileLockerPrivate::lockForWriting(const QString &path) {
+        AdvisoryLock *target;
+        if (path == filePath) {
+            if (!lock) {
+                lock = std::make_unique<AdvisoryLock>(path);
+            }
+            target = lock.get();
+        } else {
+            pendingLock = std::make_unique<AdvisoryLock>(path);
+            target = pendingLock.get();
+        }
+
+        switch (tryLock(target, FileLocker::ExclusiveLock)) {
+            case AdvisoryLock::Locked:
+                return true;
+            case AdvisoryLock::Conflict:
+                break;
+            case AdvisoryLock::Error:
+                // E.g. the directory is read-only, the lock cannot protect the file anyway
+                qCWarning(lcFileLocker) << "Cannot lock" << path << "saving without lock:"
+                                        << errorString;
+                errorString.clear();
+                return true;
+        }
+
+        qCWarning(lcFileLocker) << "Attempted to save a file locked by another process:" << path;
+        if (target == pendingLock.get()) {
+            pendingLock.reset();
+        }
+        return false;
+    }
+
+    void FileLockerPrivate::recordContent(std::optional<quint64> hash) {
+        const QFileInfo info(filePath);
+        content.size = info.size();
+        content.lastModified = info.lastModified();
+        content.hash = hash;
+    }
+
+    bool FileLockerPrivate::isContentChanged(const QFileInfo &info) {
+        if (!info.exists() || info.size() != content.size) {
+            return true;
+        }
+        if (info.lastModified() == content.lastModified) {
+            return false;
+        }
+
+        // Touched or rewritten with the same size, only the contents can tell
+        if (!content.hash) {
+            return true;
+        }
+        const auto hash = hashFile(filePath);
+        if (hash != content.hash) {
+            return true;
+        }
+        content.lastModified = info.lastModified();
+        return false;
+    }
+
+    void FileLockerPrivate::checkExternalChange() {
+        Q_Q(FileLocker);
+
+        if (filePath.isEmpty()) {
+            return;
+        }
+
+        // The file is being written by this program, check it afterwards
+        if (asyncSave) {
+            changeTimer->start();
+            return;
+        }
+
+        // Replacing the file with a rename drops the watch
+        const QFileInfo info(filePath);
+        if (info.exists() && !watcher->files().contains(filePath)) {
+            watcher->addPath(filePath);
+        }
+
+        if (isFileModifiedSinceLastSave || !isContentChanged(info)) {
+            return;
+        }
+        qCDebug(lcFileLocker) << "File" << filePath << "has been changed externally";
+        isFileModifiedSinceLastSave = true;
+        Q_EMIT q->fileModifiedSinceLastSaveChanged();
+    }
+
+    // Replays the journal left by incremental saves, if it applies to the current image
+    void FileLockerPrivate::loadJournal() {
+        journal = std::make_unique<FileLockerJournal>(filePath);
+        if (!QFile::exists(FileLockerJournal::journalFilePath(filePath))) {
+            return;
+        }
+
+        QString error;
+        if (journal->load(&error)) {
+            if (journal->isEmpty()) {
+                error = QStringLiteral("no records");
+            } else {
+                const auto hash = hashFile(filePath);
+                if (QFileInfo(filePath).size() == journal->baseSize() &&
+                    hash == journal->baseHash()) {
+                    recordContent(hash);
+                    qCInfo(lcFileLocker) << "Replaying the journal of" << filePath << "with"
+                                         << journal->byteSize() << "bytes";
+                    return;
+                }
+                error = QStringLiteral("written for another image");
+            }
+        }
+        qCWarning(lcFileLocker) << "Dropping the journal of" << filePath << "Error:" << error;
+
+        // Only the writer removes it
+        if (lockMode() == FileLocker::ExclusiveLock) {
+            journal->discard();
+        } else {
+            journal = std::make_unique<FileLockerJournal>(filePath);
+        }
+    }
+
+    // A full image supersedes the journal
+    void FileLockerPrivate::discardJournal() {
+        journal = std::make_unique<FileLockerJournal>(filePath);
+        journal->discard();
+    }
+
     void FileLocker::close() {
         Q_D(FileLocker);
+        d->readCancelled = true;
+        d->waitForAsyncSave();
+        d->rollbackWriter();
 
         d->errorString.clear();
 
         d->file.reset();
+        d->setLock(nullptr);
         
         // Remove from watcher
         d->watcher->removePath(d->filePath);
+        d->changeTimer->stop();
+        d->content = {};
+        d->journal.reset();
         
         // Clear file path
         d->filePath.clear();
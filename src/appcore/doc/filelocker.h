@@ -1,14 +1,47 @@
 #ifndef CHORUSKIT_FILELOCKER_H
 #define CHORUSKIT_FILELOCKER_H
 
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include <QByteArrayView>
+#include <QDateTime>
 #include <QObject>
 #include <qqmlintegration.h>
 
 #include <CoreApi/ckappcoreglobal.h>
 
+class QFile;
+
 namespace Core {
 
     class FileLockerPrivate;
+    class FileLockerWriter;
+
+    class CKAPPCORE_EXPORT FileLockerMapping {
+    public:
+        FileLockerMapping();
+        FileLockerMapping(FileLockerMapping &&other) noexcept;
+        FileLockerMapping &operator=(FileLockerMapping &&other) noexcept;
+        ~FileLockerMapping();
+
+        bool isValid() const;
+        QByteArrayView data() const;
+        qint64 size() const;
+
+        void reset();
+
+    private:
+        friend class FileLocker;
+
+        std::unique_ptr<QFile> m_file;
+        const uchar *m_address;
+        qint64 m_size;
+        std::shared_ptr<std::atomic_int> m_counter;
+
+        Q_DISABLE_COPY(FileLockerMapping)
+    };
 
     class CKAPPCORE_EXPORT FileLocker : public QObject {
         Q_OBJECT
@@ -18,8 +51,36 @@ namespace Core {
         Q_PROPERTY(QString path READ path NOTIFY pathChanged)
         Q_PROPERTY(QString entryName READ entryName NOTIFY entryNameChanged)
         Q_PROPERTY(bool fileModifiedSinceLastSave READ isFileModifiedSinceLastSave NOTIFY fileModifiedSinceLastSaveChanged)
+        Q_PROPERTY(SaveMode saveMode READ saveMode WRITE setSaveMode NOTIFY saveModeChanged)
+        Q_PROPERTY(bool saving READ isSaving NOTIFY savingChanged)
+        Q_PROPERTY(LockMode lockMode READ lockMode NOTIFY lockModeChanged)
 
     public:
+        enum SaveMode {
+            InPlace,
+            Atomic,
+        };
+        Q_ENUM(SaveMode)
+
+        enum LockMode {
+            Unlocked,
+            SharedLock,
+            ExclusiveLock,
+        };
+        Q_ENUM(LockMode)
+
+        struct LockOwner {
+            qint64 pid = 0;
+            QString hostName;
+            QString applicationName;
+            QDateTime lockTime;
+        };
+
+        struct Patch {
+            qint64 offset = 0;
+            QByteArray data;
+        };
+
         explicit FileLocker(QObject *parent = nullptr);
         ~FileLocker() override;
 
@@ -28,20 +89,54 @@ namespace Core {
         QString errorString() const;
         bool isFileModifiedSinceLastSave() const;
 
+        SaveMode saveMode() const;
+        void setSaveMode(SaveMode mode);
+
         Q_INVOKABLE bool open(const QString &path);
+        FileLockerMapping map(bool *ok = nullptr);
         Q_INVOKABLE QByteArray readData(bool *ok = nullptr);
+        bool readChunks(const std::function<bool(QByteArrayView chunk)> &consumer);
+        Q_INVOKABLE bool readDataAsync();
+        Q_INVOKABLE void cancelRead();
+        qint64 readChunkSize() const;
+        void setReadChunkSize(qint64 bytes);
         Q_INVOKABLE void release();
         Q_INVOKABLE bool save(const QByteArray &data);
         Q_INVOKABLE bool saveAs(const QString &path, const QByteArray &data);
+        Q_INVOKABLE bool saveAsync(QByteArray data);
+        bool saveIncremental(const QList<Patch> &patches, qint64 size = -1);
+        Q_INVOKABLE bool saveAppend(const QByteArray &data);
+        Q_INVOKABLE bool compactJournal();
+        qint64 journalSize() const;
+        qint64 journalCompactionThreshold() const;
+        void setJournalCompactionThreshold(qint64 bytes);
+        bool isSaving() const;
+        FileLockerWriter *beginSave();
+        FileLockerWriter *beginSaveAs(const QString &path);
         Q_INVOKABLE void close();
 
+        LockMode lockMode() const;
+        bool tryLock(LockMode mode, LockOwner *owner = nullptr);
+        Q_INVOKABLE void unlock();
+        LockOwner lockOwner() const;
+
     Q_SIGNALS:
         void pathChanged();
         void entryNameChanged();
         void fileModifiedSinceLastSaveChanged();
+        void saveModeChanged();
+        void savingChanged();
+        void saveFinished();
+        void saveFailed(const QString &errorString);
+        void lockModeChanged();
+        void readProgress(qint64 bytesRead, qint64 bytesTotal);
+        void readFinished(const QByteArray &data);
+        void readFailed(const QString &errorString);
 
     private:
         QScopedPointer<FileLockerPrivate> d_ptr;
+
+        FileLockerWriter *createWriter(const QString &path, bool saveAs);
     };
 
 }
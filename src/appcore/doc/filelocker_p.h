@@ -2,14 +2,64 @@
 #define CHORUSKIT_FILELOCKER_P_H
 
 #include <CoreApi/filelocker.h>
+#include <CoreApi/filelockerwriter.h>
 
 #include <memory>
+#include <optional>
 
+#include <QDateTime>
 #include <QFile>
 #include <QFileSystemWatcher>
+#include <QPointer>
+#include <QThreadPool>
+
+#include "advisorylock_p.h"
+#include "filelockerjournal_p.h"
+
+class QFileInfo;
+class QSaveFile;
+class QThread;
+class QTimer;
 
 namespace Core {
 
+    // Flushes the file to the storage device, not only to the OS cache
+    bool syncFile(QFileDevice *file);
+
+    struct AsyncSaveJob {
+        QByteArray data;
+        QString path;
+        FileLocker::SaveMode mode;
+        QThread *thread;
+
+        // Mappings of the file, the in place fallback is refused while there are any
+        std::shared_ptr<std::atomic_int> mappingCount;
+
+        // Result, written by the worker
+        quint64 hash = 0;
+        bool ok = false;
+        QString errorString;
+        std::unique_ptr<QSaveFile> saveFile;
+    };
+
+    struct AsyncReadJob {
+        QString path;
+        qint64 chunkSize;
+
+        // Result, written by the worker
+        QByteArray data;
+        quint64 hash = 0;
+        bool ok = false;
+        QString errorString;
+    };
+
+    // What this program last read from or wrote to the file
+    struct ContentState {
+        qint64 size = -1;
+        QDateTime lastModified;
+        std::optional<quint64> hash;
+    };
+
     class FileLockerPrivate {
         Q_DECLARE_PUBLIC(FileLocker)
     public:
@@ -19,6 +69,60 @@ namespace Core {
         QFileSystemWatcher *watcher;
         QString errorString;
         bool isFileModifiedSinceLastSave{};
+        FileLocker::SaveMode saveMode{FileLocker::Atomic};
+
+        // Number of alive mappings, shared with them so that they can outlive the locker
+        std::shared_ptr<std::atomic_int> mappingCount = std::make_shared<std::atomic_int>(0);
+
+        // The streaming save in progress, cleared when it commits or rolls back. The writer is a
+        // child of the locker, callers may delete it once it is finished
+        QPointer<FileLockerWriter> writer;
+
+        bool isWriting();
+        void rollbackWriter();
+        bool commitWriter(QSaveFile *saveFile, const QString &path, bool saveAs, qint64 size,
+                          std::optional<quint64> hash = {}, bool synced = false);
+
+        // Watcher notifications are debounced and dropped if the contents are unchanged
+        ContentState content;
+        QTimer *changeTimer;
+
+        void recordContent(std::optional<quint64> hash);
+        bool isContentChanged(const QFileInfo &info);
+        void checkExternalChange();
+
+        // Asynchronous saves, one at a time on a dedicated thread
+        QThreadPool savePool;
+        std::shared_ptr<AsyncSaveJob> asyncSave;
+        std::optional<QByteArray> queuedSaveData;
+
+        bool startAsyncSave(QByteArray data);
+        void finishAsyncSave(const std::shared_ptr<AsyncSaveJob> &job);
+        void waitForAsyncSave();
+
+        // Chunked reads, the asynchronous one runs on the save thread
+        qint64 readChunkSize{4 * 1024 * 1024};
+        std::atomic_bool readCancelled{false};
+        std::shared_ptr<AsyncReadJob> asyncRead;
+
+        void finishAsyncRead(const std::shared_ptr<AsyncReadJob> &job);
+
+        // Advisory lock of the current file, and of the target of a running save as
+        std::unique_ptr<AdvisoryLock> lock;
+        std::unique_ptr<AdvisoryLock> pendingLock;
+        FileLocker::LockOwner lockOwner;
+
+        FileLocker::LockMode lockMode() const;
+        void setLock(std::unique_ptr<AdvisoryLock> newLock);
+        AdvisoryLock::Result tryLock(AdvisoryLock *target, FileLocker::LockMode mode);
+        bool lockForWriting(const QString &path);
+
+        // Incremental saves that are not compacted into the image yet
+        std::unique_ptr<FileLockerJournal> journal;
+        qint64 journalCompactionThreshold{16 * 1024 * 1024};
+
+        void loadJournal();
+        void discardJournal();
     };
 
 }
@@ -0,0 +1,271 @@
+#include "filelockerjournal_p.h"
+#include "filelocker_p.h"
+#include "xxhash64_p.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QCoreApplication>
+#include <QtEndian>
+
+namespace Core {
+
+    static constexpr quint32 JOURNAL_MAGIC = 0x434b4a4c; // CKJL
+    static constexpr quint32 JOURNAL_VERSION = 1;
+    static constexpr quint32 RECORD_MAGIC = 0x434b4a52; // CKJR
+
+    // magic, version, base size, base hash
+    static constexpr qint64 HEADER_SIZE = 24;
+
+    // magic, payload size before the payload, payload hash after it
+    static constexpr qint64 RECORD_HEAD_SIZE = 12;
+    static constexpr qint64 RECORD_TAIL_SIZE = 8;
+
+    template <class T>
+    static void appendValue(QByteArray &out, T value) {
+        const T le = qToLittleEndian(value);
+        out.append(reinterpret_cast<const char *>(&le), sizeof(T));
+    }
+
+    template <class T>
+    static bool takeValue(QByteArrayView &in, T *value) {
+        if (in.size() < qsizetype(sizeof(T))) {
+            return false;
+        }
+        *value = qFromLittleEndian<T>(in.data());
+        in = in.sliced(sizeof(T));
+        return true;
+    }
+
+    static QByteArray serializeRecord(const FileLockerJournal::Record &record) {
+        QByteArray payload;
+        appendValue<qint64>(payload, record.size);
+        appendValue<quint32>(payload, quint32(record.patches.size()));
+        for (const auto &patch : record.patches) {
+            appendValue<qint64>(payload, patch.offset);
+            appendValue<qint64>(payload, patch.data.size());
+            payload.append(patch.data);
+        }
+
+        QByteArray out;
+        out.reserve(RECORD_HEAD_SIZE + payload.size() + RECORD_TAIL_SIZE);
+        appendValue<quint32>(out, RECORD_MAGIC);
+        appendValue<quint64>(out, quint64(payload.size()));
+        out.append(payload);
+        appendValue<quint64>(out, xxHash64(payload));
+        return out;
+    }
+
+    static bool parseRecord(QByteArrayView payload, FileLockerJournal::Record *record) {
+        quint32 count;
+        if (!takeValue(payload, &record->size) || !takeValue(payload, &count) ||
+            record->size < 0) {
+            return false;
+        }
+        record->patches.clear();
+        for (quint32 i = 0; i < count; ++i) {
+            FileLocker::Patch patch;
+            qint64 length;
+            if (!takeValue(payload, &patch.offset) || !takeValue(payload, &length) ||
+                patch.offset < 0 || length < 0 || length > payload.size() ||
+                patch.offset + length > record->size) {
+                return false;
+            }
+            patch.data = payload.first(length).toByteArray();
+            payload = payload.sliced(length);
+            record->patches.append(std::move(patch));
+        }
+        return payload.isEmpty();
+    }
+
+    FileLockerJournal::FileLockerJournal(const QString &filePath)
+        : m_journalPath(journalFilePath(filePath)), m_baseSize(-1), m_baseHash(0),
+          m_validSize(0) {
+    }
+
+    FileLockerJournal::~FileLockerJournal() = default;
+
+    QString FileLockerJournal::journalFilePath(const QString &filePath) {
+        return filePath + QStringLiteral(".journal");
+    }
+
+    /*!
+        Reads the records of an existing journal. A torn record at the end, left by a crash
+        during an append, ends the journal and is overwritten by the next append.
+    */
+    bool FileLockerJournal::load(QString *errorString) {
+        m_file.close();
+        m_records.clear();
+        m_baseSize = -1;
+        m_baseHash = 0;
+        m_validSize = 0;
+
+        if (!QFile::exists(m_journalPath)) {
+            return true;
+        }
+
+        QFile file(m_journalPath);
+        if (!file.open(QIODevice::ReadOnly)) {
+            *errorString = file.errorString();
+            return false;
+        }
+        const QByteArray content = file.readAll();
+        if (file.error() != QFile::NoError) {
+            *errorString = file.errorString();
+            return false;
+        }
+
+        QByteArrayView in(content);
+        quint32 magic, version;
+        if (!takeValue(in, &magic) || !takeValue(in, &version) || !takeValue(in, &m_baseSize) ||
+            !takeValue(in, &m_baseHash) || magic != JOURNAL_MAGIC ||
+            version != JOURNAL_VERSION) {
+            *errorString = QCoreApplication::translate("Core::FileLocker",
+                                                       "The journal header is invalid");
+            m_baseSize = -1;
+            return false;
+        }
+        m_validSize = HEADER_SIZE;
+
+        while (!in.isEmpty()) {
+            quint64 payloadSize;
+            if (!takeValue(in, &magic) || !takeValue(in, &payloadSize) ||
+                magic != RECORD_MAGIC || payloadSize > quint64(in.size()) ||
+                qint64(payloadSize) + RECORD_TAIL_SIZE > in.size()) {
+                break;
+            }
+            const auto payload = in.first(qsizetype(payloadSize));
+            in = in.sliced(qsizetype(payloadSize));
+
+            quint64 hash;
+            Record record;
+            if (!takeValue(in, &hash) || hash != xxHash64(payload) ||
+                !parseRecord(payload, &record)) {
+                break;
+            }
+            m_records.append(std::move(record));
+            m_validSize += RECORD_HEAD_SIZE + qint64(payloadSize) + RECORD_TAIL_SIZE;
+        }
+        return true;
+    }
+
+    /*!
+        Appends \a record and syncs it. The first record starts the journal for the image of
+        \a baseSize and \a baseHash, the arguments are ignored for the following ones.
+    */
+    bool FileLockerJournal::append(const Record &record, qint64 baseSize, quint64 baseHash,
+                                   QString *errorString) {
+        if (!m_file.isOpen()) {
+            m_file.setFileName(m_journalPath);
+            if (!m_file.open(QIODevice::ReadWrite)) {
+                *errorString = m_file.errorString();
+                return false;
+            }
+        }
+
+        // The first record pins the image the journal applies to
+        if (m_records.isEmpty()) {
+            QByteArray header;
+            appendValue<quint32>(header, JOURNAL_MAGIC);
+            appendValue<quint32>(header, JOURNAL_VERSION);
+            appendValue<qint64>(header, baseSize);
+            appendValue<quint64>(header, baseHash);
+            if (!m_file.resize(0) || m_file.write(header) != header.size()) {
+                *errorString = m_file.errorString();
+                return false;
+            }
+            m_baseSize = baseSize;
+            m_baseHash = baseHash;
+            m_validSize = HEADER_SIZE;
+        }
+
+        // Cut off a torn record before appending
+        const QByteArray data = serializeRecord(record);
+        if (m_file.size() != m_validSize && !m_file.resize(m_validSize)) {
+            *errorString = m_file.errorString();
+            return false;
+        }
+        if (!m_file.seek(m_validSize) || m_file.write(data) != data.size() ||
+            !syncFile(&m_file)) {
+            *errorString = m_file.errorString();
+            return false;
+        }
+
+        m_validSize += data.size();
+        m_records.append(record);
+        return true;
+    }
+
+    void FileLockerJournal::discard() {
+        m_file.close();
+        QFile::remove(m_journalPath);
+        m_records.clear();
+        m_baseSize = -1;
+        m_baseHash = 0;
+        m_validSize = 0;
+    }
+
+    bool FileLockerJournal::isEmpty() const {
+        return m_records.isEmpty();
+    }
+
+    qint64 FileLockerJournal::byteSize() const {
+        return m_validSize;
+    }
+
+    qint64 FileLockerJournal::baseSize() const {
+        return m_baseSize;
+    }
+
+    quint64 FileLockerJournal::baseHash() const {
+        return m_baseHash;
+    }
+
+    // Size of the document with all records applied
+    qint64 FileLockerJournal::size() const {
+        return m_records.isEmpty() ? m_baseSize : m_records.constLast().size;
+    }
+
+    void FileLockerJournal::replay(QByteArray &data) const {
+        for (const auto &record : m_records) {
+            const qint64 oldSize = data.size();
+            if (record.size < oldSize) {
+                data.truncate(record.size);
+            } else if (record.size > oldSize) {
+                data.append(record.size - oldSize, '\0');
+            }
+            for (const auto &patch : record.patches) {
+                std::memcpy(data.data() + patch.offset, patch.data.constData(),
+                            size_t(patch.data.size()));
+            }
+        }
+    }
+
+    // Applies the journal to the range of the document starting at \a offset. \a chunk holds
+    // the image in that range and zeros past the end of the image.
+    void FileLockerJournal::replayRange(qint64 offset, QByteArray &chunk) const {
+        const qint64 end = offset + chunk.size();
+        qint64 size = m_baseSize;
+        for (const auto &record : m_records) {
+            // Bytes cut off by a shrink read as zeros if the document grows again
+            if (record.size < size) {
+                const qint64 from = std::max(offset, record.size);
+                const qint64 to = std::min(end, size);
+                if (from < to) {
+                    std::memset(chunk.data() + (from - offset), 0, size_t(to - from));
+                }
+            }
+            size = record.size;
+
+            for (const auto &patch : record.patches) {
+                const qint64 from = std::max(offset, patch.offset);
+                const qint64 to = std::min(end, patch.offset + patch.data.size());
+                if (from < to) {
+                    std::memcpy(chunk.data() + (from - offset),
+                                patch.data.constData() + (from - patch.offset), size_t(to - from));
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,53 @@
+#ifndef CHORUSKIT_FILELOCKERJOURNAL_P_H
+#define CHORUSKIT_FILELOCKERJOURNAL_P_H
+
+#include <QFile>
+#include <QList>
+
+#include <CoreApi/filelocker.h>
+
+namespace Core {
+
+    // Append-only log of incremental saves, kept in `<path>.journal` next to the document.
+    // The header identifies the full image the records apply to, so a journal left behind by
+    // a crash after a full save, or by an external change of the image, is detected as stale.
+    class FileLockerJournal {
+    public:
+        struct Record {
+            qint64 size;
+            QList<FileLocker::Patch> patches;
+        };
+
+        explicit FileLockerJournal(const QString &filePath);
+        ~FileLockerJournal();
+
+        static QString journalFilePath(const QString &filePath);
+
+        bool load(QString *errorString);
+        bool append(const Record &record, qint64 baseSize, quint64 baseHash,
+                    QString *errorString);
+        void discard();
+
+        bool isEmpty() const;
+        qint64 byteSize() const;
+        qint64 baseSize() const;
+        quint64 baseHash() const;
+        qint64 size() const;
+
+        void replay(QByteArray &data) const;
+        void replayRange(qint64 offset, QByteArray &chunk) const;
+
+    private:
+        QString m_journalPath;
+        QFile m_file;
+        qint64 m_baseSize;
+        quint64 m_baseHash;
+        qint64 m_validSize;
+        QList<Record> m_records;
+
+        Q_DISABLE_COPY(FileLockerJournal)
+    };
+
+}
+
+#endif // CHORUSKIT_FILELOCKERJOURNAL_P_H
@@ -0,0 +1,167 @@
+#include "filelockerwriter.h"
+#include "filelockerwriter_p.h"
+
+#include <QLoggingCategory>
+
+#include "filelocker.h"
+#include "filelocker_p.h"
+
+namespace Core {
+
+    Q_STATIC_LOGGING_CATEGORY(lcFileLockerWriter, "ck.filelockerwriter")
+
+    // Interval between two progress notifications in milliseconds
+    static constexpr qint64 PROGRESS_INTERVAL = 100;
+
+    void FileLockerWriterPrivate::emitProgress() {
+        Q_Q(FileLockerWriter);
+        lastProgressTime = timer.elapsed();
+        Q_EMIT q->progressChanged(bytesWritten, q->bytesPerSecond());
+    }
+
+    /*!
+        \class FileLockerWriter
+        \brief Streaming writer returned by FileLocker::beginSave() and FileLocker::beginSaveAs().
+
+        Data is written to a temporary file next to the target, which replaces the target on
+        commit() and is discarded on rollback(). A writer destroyed without commit rolls back.
+        The locker accepts other saves once the writer is committed or rolled back.
+    */
+
+    FileLockerWriter::FileLockerWriter(FileLocker *locker, FileLockerPrivate *lockerPrivate,
+                                       const QString &path, bool saveAs)
+        : QIODevice(locker), d_ptr(new FileLockerWriterPrivate) {
+        Q_D(FileLockerWriter);
+        d->q_ptr = this;
+        d->locker = locker;
+        d->lockerPrivate = lockerPrivate;
+        d->filePath = path;
+        d->saveAs = saveAs;
+
+        d->file = std::make_unique<QSaveFile>(path);
+        if (!d->file->open(QIODevice::WriteOnly)) {
+            setErrorString(d->file->errorString());
+            qCWarning(lcFileLockerWriter) << "Failed to open temporary file for" << path
+                                          << "Error:" << errorString();
+            return;
+        }
+
+        // The save file does the buffering
+        QIODevice::open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+        d->timer.start();
+    }
+
+    FileLockerWriter::~FileLockerWriter() {
+        if (isOpen()) {
+            rollback();
+        }
+    }
+
+    QString FileLockerWriter::fileName() const {
+        Q_D(const FileLockerWriter);
+        return d->filePath;
+    }
+
+    bool FileLockerWriter::isSequential() const {
+        return true;
+    }
+
+    /*!
+        Replaces the target file with the written data and makes the locker hold it.
+    */
+    bool FileLockerWriter::commit() {
+        Q_D(FileLockerWriter);
+
+        if (!isOpen()) {
+            qCWarning(lcFileLockerWriter) << "Attempted to commit a closed writer";
+            return false;
+        }
+
+        if (!d->locker) {
+            setErrorString(tr("The file locker has been destroyed"));
+            rollback();
+            return false;
+        }
+
+        d->emitProgress();
+        QIODevice::close();
+        d->lockerPrivate->writer = nullptr;
+
+        // No save starts while a writer is active, still make sure that none can race the rename
+        d->lockerPrivate->waitForAsyncSave();
+
+        if (!d->lockerPrivate->commitWriter(d->file.get(), d->filePath, d->saveAs,
+                                            d->bytesWritten)) {
+            setErrorString(d->lockerPrivate->errorString);
+            d->file.reset();
+            return false;
+        }
+        d->file.reset();
+
+        qCDebug(lcFileLockerWriter) << "Committed" << d->bytesWritten << "bytes to" << d->filePath
+                                    << "at" << bytesPerSecond() << "bytes/s";
+        return true;
+    }
+
+    /*!
+        Discards the written data, the target file is left untouched.
+    */
+    void FileLockerWriter::rollback() {
+        Q_D(FileLockerWriter);
+
+        if (!isOpen()) {
+            return;
+        }
+        QIODevice::close();
+
+        d->file->cancelWriting();
+        d->file.reset();
+
+        if (d->locker) {
+            d->lockerPrivate->writer = nullptr;
+
+            // Release the lock of the target the locker doesn't switch to
+            if (d->saveAs) {
+                d->lockerPrivate->pendingLock.reset();
+            }
+        }
+
+        qCDebug(lcFileLockerWriter) << "Rolled back save to" << d->filePath;
+    }
+
+    qint64 FileLockerWriter::totalBytesWritten() const {
+        Q_D(const FileLockerWriter);
+        return d->bytesWritten;
+    }
+
+    double FileLockerWriter::bytesPerSecond() const {
+        Q_D(const FileLockerWriter);
+        const qint64 nsecs = d->timer.isValid() ? d->timer.nsecsElapsed() : 0;
+        return nsecs > 0 ? double(d->bytesWritten) * 1e9 / double(nsecs) : 0;
+    }
+
+    qint64 FileLockerWriter::readData(char *data, qint64 maxSize) {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+    qint64 FileLockerWriter::writeData(const char *data, qint64 size) {
+        Q_D(FileLockerWriter);
+
+        const qint64 written = d->file->write(data, size);
+        if (written < 0) {
+            setErrorString(d->file->errorString());
+            return -1;
+        }
+        d->bytesWritten += written;
+
+        if (d->timer.elapsed() - d->lastProgressTime >= PROGRESS_INTERVAL) {
+            d->emitProgress();
+        }
+        return written;
+    }
+
+}
+
+#include "moc_filelockerwriter.cpp"
@@ -0,0 +1,46 @@
+#ifndef CHORUSKIT_FILELOCKERWRITER_H
+#define CHORUSKIT_FILELOCKERWRITER_H
+
+#include <QIODevice>
+
+#include <CoreApi/ckappcoreglobal.h>
+
+namespace Core {
+
+    class FileLocker;
+    class FileLockerPrivate;
+    class FileLockerWriterPrivate;
+
+    class CKAPPCORE_EXPORT FileLockerWriter : public QIODevice {
+        Q_OBJECT
+        Q_DECLARE_PRIVATE(FileLockerWriter)
+    public:
+        ~FileLockerWriter() override;
+
+        QString fileName() const;
+        bool isSequential() const override;
+
+        bool commit();
+        void rollback();
+
+        qint64 totalBytesWritten() const;
+        double bytesPerSecond() const;
+
+    Q_SIGNALS:
+        void progressChanged(qint64 bytesWritten, double bytesPerSecond);
+
+    protected:
+        qint64 readData(char *data, qint64 maxSize) override;
+        qint64 writeData(const char *data, qint64 size) override;
+
+    private:
+        friend class FileLocker;
+        FileLockerWriter(FileLocker *locker, FileLockerPrivate *lockerPrivate, const QString &path,
+                         bool saveAs);
+
+        QScopedPointer<FileLockerWriterPrivate> d_ptr;
+    };
+
+}
+
+#endif // CHORUSKIT_FILELOCKERWRITER_H
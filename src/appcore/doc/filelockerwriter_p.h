@@ -0,0 +1,32 @@
+#ifndef CHORUSKIT_FILELOCKERWRITER_P_H
+#define CHORUSKIT_FILELOCKERWRITER_P_H
+
+#include <CoreApi/filelockerwriter.h>
+
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSaveFile>
+
+namespace Core {
+
+    class FileLockerWriterPrivate {
+        Q_DECLARE_PUBLIC(FileLockerWriter)
+    public:
+        FileLockerWriter *q_ptr;
+        QPointer<FileLocker> locker;
+        FileLockerPrivate *lockerPrivate;
+        QString filePath;
+        bool saveAs{};
+        std::unique_ptr<QSaveFile> file;
+        qint64 bytesWritten{};
+        QElapsedTimer timer;
+        qint64 lastProgressTime{};
+
+        void emitProgress();
+    };
+
+}
+
+#endif // CHORUSKIT_FILELOCKERWRITER_P_H
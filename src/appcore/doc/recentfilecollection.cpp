@@ -1,36 +1,58 @@
 #include "recentfilecollection.h"
 #include "recentfilecollection_p.h"
 
+#include <algorithm>
+
 #include <QFileInfo>
 #include <QDir>
 #include <QCryptographicHash>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QLoggingCategory>
+#include <QImage>
 #include <QPixmap>
 
 #include <CoreApi/applicationinfo.h>
 #include <CoreApi/runtimeinterface.h>
 
+#include "recentfilethumbnailprovider_p.h"
+
 namespace Core {
 
     Q_STATIC_LOGGING_CATEGORY(lcRecentFileCollection, "ck.recentfilecollection")
 
+    // Minimum interval between two revalidations of the entries in milliseconds
+    static constexpr qint64 REVALIDATION_INTERVAL = 60 * 1000;
+
+    // Memory of the decoded thumbnails kept in the cache in KiB
+    static constexpr int THUMBNAIL_CACHE_SIZE = 32 * 1024;
+
+    static int thumbnailCost(const QPixmap &pixmap) {
+        const qint64 bytes = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+        return std::max(1, int(bytes / 1024));
+    }
+
     void RecentFileCollectionPrivate::init() {
-        // Initialize thumbnail directory
         QString dataDir = ApplicationInfo::applicationLocation(ApplicationInfo::RuntimeData);
+        if (!QDir().mkpath(dataDir)) {
+            qCWarning(lcRecentFileCollection) << "Failed to create data directory:" << dataDir;
+        }
+
+        // Older versions stored a PNG per entry, they are imported into the pack
         thumbnailDir = QDir(dataDir).absoluteFilePath("thumbnails");
-        ensureThumbnailDir();
+        hasLegacyThumbnails = QFileInfo(thumbnailDir).isDir();
+
+        thumbnailPack = std::make_unique<ThumbnailPack>(
+            QDir(dataDir).absoluteFilePath("thumbnails.pack"));
+        thumbnailPack->open(count);
+        revalidationPool.setMaxThreadCount(1);
+        thumbnailPool.setMaxThreadCount(1);
+        thumbnailCache.setMaxCost(THUMBNAIL_CACHE_SIZE);
     }
 
-    QString RecentFileCollectionPrivate::thumbnailPath(const QString &filePath) const {
-        QString canonical = canonicalFilePath(filePath);
-        if (canonical.isEmpty()) {
-            return {};
-        }
-        
+    QString RecentFileCollectionPrivate::legacyThumbnailPath(const QString &entry) const {
         // Use MD5 hash to generate filename
-        QByteArray hash = QCryptographicHash::hash(canonical.toUtf8(), QCryptographicHash::Md5);
+        QByteArray hash = QCryptographicHash::hash(entry.toUtf8(), QCryptographicHash::Md5);
         QString fileName = QString::fromLatin1(hash.toHex()) + ".png";
         return QDir(thumbnailDir).absoluteFilePath(fileName);
     }
@@ -40,26 +62,188 @@ namespace Core {
         return info.canonicalFilePath();
     }
 
-    void RecentFileCollectionPrivate::ensureThumbnailDir() {
-        QDir dir(thumbnailDir);
-        if (!dir.exists()) {
-            if (!dir.mkpath(".")) {
-                qCWarning(lcRecentFileCollection) << "Failed to create thumbnail directory:" << thumbnailDir;
+    // Entries are looked up as they are before resolving the path on the file system
+    QString RecentFileCollectionPrivate::entryKey(const QString &path) const {
+        if (recentFileSet.contains(path)) {
+            return path;
+        }
+        return canonicalFilePath(path);
+    }
+
+    void RecentFileCollectionPrivate::setRecentFiles(const QStringList &files) {
+        recentFiles.clear();
+        recentFileSet.clear();
+        unavailableFiles.clear();
+        for (const auto &file : files) {
+            if (!recentFileSet.contains(file)) {
+                recentFileSet.insert(file);
+                recentFiles.append(file);
+            }
+        }
+    }
+
+    void RecentFileCollectionPrivate::takeRecentFile(const QString &entry) {
+        recentFiles.removeOne(entry);
+        recentFileSet.remove(entry);
+        unavailableFiles.remove(entry);
+    }
+
+    void RecentFileCollectionPrivate::cleanupThumbnail(const QString &entry) {
+        thumbnailCache.remove(entry);
+        thumbnailPool.start([pack = thumbnailPack.get(), entry]() {
+            pack->remove(entry);
+            qCDebug(lcRecentFileCollection) << "Removed thumbnail of:" << entry;
+        });
+    }
+
+    void RecentFileCollectionPrivate::saveThumbnail(const QString &entry,
+                                                    const QPixmap &thumbnail) {
+        Q_Q(RecentFileCollection);
+
+        // Served from memory until it is evicted, by then it has been written
+        thumbnailCache.insert(entry, new QPixmap(thumbnail), thumbnailCost(thumbnail));
+        pendingThumbnailWrites.insert(entry);
+
+        // Pixmaps belong to the GUI thread, the worker copies the pixels of an image
+        thumbnailPool.start([q, pack = thumbnailPack.get(), entry, image = thumbnail.toImage()]() {
+            if (!pack->store(entry, image)) {
+                qCWarning(lcRecentFileCollection) << "Failed to save thumbnail for:" << entry;
             } else {
-                qCDebug(lcRecentFileCollection) << "Created thumbnail directory:" << thumbnailDir;
+                qCDebug(lcRecentFileCollection) << "Saved thumbnail of:" << entry;
             }
+            QMetaObject::invokeMethod(
+                q, [q, entry]() {
+                    q->d_func()->pendingThumbnailWrites.remove(entry);
+                    q->d_func()->thumbnailRevisions[entry]++;
+                    Q_EMIT q->thumbnailReady(entry);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    void RecentFileCollectionPrivate::renameThumbnail(const QString &entry,
+                                                      const QString &newEntry) {
+        if (auto pixmap = thumbnailCache.take(entry)) {
+            thumbnailCache.insert(newEntry, pixmap, thumbnailCost(*pixmap));
         }
+        thumbnailPool.start([pack = thumbnailPack.get(), entry, newEntry]() {
+            pack->rename(entry, newEntry);
+        });
     }
 
-    void RecentFileCollectionPrivate::cleanupThumbnail(const QString &filePath) {
-        QString thumbPath = thumbnailPath(filePath);
-        if (!thumbPath.isEmpty() && QFile::exists(thumbPath)) {
-            if (QFile::remove(thumbPath)) {
-                qCDebug(lcRecentFileCollection) << "Removed thumbnail:" << thumbPath;
+    // Called on the worker thread, falls back to the PNG of an older version and imports it
+    QImage RecentFileCollectionPrivate::loadThumbnail(const QString &entry) const {
+        QImage image = thumbnailPack->image(entry);
+        if (!image.isNull() || !hasLegacyThumbnails) {
+            return image;
+        }
+        const QString legacyPath = legacyThumbnailPath(entry);
+        if (image.load(legacyPath)) {
+            thumbnailPack->store(entry, image);
+            QFile::remove(legacyPath);
+        }
+        return image;
+    }
+
+    void RecentFileCollectionPrivate::importLegacyThumbnails() {
+        if (!hasLegacyThumbnails) {
+            return;
+        }
+
+        // Ordered before any other access to the pack
+        QStringList legacyPaths;
+        for (const auto &file : std::as_const(recentFiles)) {
+            legacyPaths.append(legacyThumbnailPath(file));
+        }
+        thumbnailPool.start([this, files = recentFiles, legacyPaths]() {
+            for (qsizetype i = 0; i < files.size(); ++i) {
+                QImage image;
+                if (image.load(legacyPaths.at(i))) {
+                    thumbnailPack->store(files.at(i), image);
+                }
+            }
+            if (QDir(thumbnailDir).removeRecursively()) {
+                hasLegacyThumbnails = false;
+                qCInfo(lcRecentFileCollection) << "Imported thumbnails from:" << thumbnailDir;
+            }
+        });
+    }
+
+    void RecentFileCollectionPrivate::requestRevalidation() const {
+        if (revalidating || recentFiles.isEmpty() ||
+            (lastRevalidation.isValid() && !lastRevalidation.hasExpired(REVALIDATION_INTERVAL))) {
+            return;
+        }
+        revalidating = true;
+
+        // Resolving paths blocks on slow and unmounted network drives
+        auto q = q_ptr;
+        revalidationPool.start([q, files = recentFiles]() {
+            QStringList canonicalPaths;
+            canonicalPaths.reserve(files.size());
+            for (const auto &file : files) {
+                canonicalPaths.append(QFileInfo(file).canonicalFilePath());
+            }
+            QMetaObject::invokeMethod(
+                q, [q, files, canonicalPaths]() {
+                    q->d_func()->applyRevalidation(files, canonicalPaths);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    void RecentFileCollectionPrivate::applyRevalidation(const QStringList &files,
+                                                       const QStringList &canonicalPaths) {
+        Q_Q(RecentFileCollection);
+        revalidating = false;
+        lastRevalidation.start();
+
+        bool availabilityChanged = false;
+        bool listChanged = false;
+        for (qsizetype i = 0; i < files.size(); ++i) {
+            const auto &file = files.at(i);
+            const auto &canonical = canonicalPaths.at(i);
+
+            // Removed while revalidating
+            if (!recentFileSet.contains(file)) {
+                continue;
+            }
+
+            if (canonical.isEmpty()) {
+                if (!unavailableFiles.contains(file)) {
+                    unavailableFiles.insert(file);
+                    availabilityChanged = true;
+                }
+                continue;
+            }
+            if (unavailableFiles.remove(file)) {
+                availabilityChanged = true;
+            }
+            if (canonical == file) {
+                continue;
+            }
+
+            // Stored by an older version, or a link in the path has changed
+            qCDebug(lcRecentFileCollection) << "Recent file" << file << "resolves to" << canonical;
+            listChanged = true;
+            const auto index = recentFiles.indexOf(file);
+            recentFileSet.remove(file);
+            if (recentFileSet.contains(canonical)) {
+                recentFiles.removeAt(index);
+                cleanupThumbnail(file);
             } else {
-                qCWarning(lcRecentFileCollection) << "Failed to remove thumbnail:" << thumbPath;
+                recentFiles[index] = canonical;
+                recentFileSet.insert(canonical);
+                renameThumbnail(file, canonical);
             }
         }
+
+        if (listChanged || availabilityChanged) {
+            Q_EMIT q->recentFilesChanged();
+        }
+        if (listChanged) {
+            q->saveSettings();
+        }
     }
 
     RecentFileCollection::RecentFileCollection(QObject *parent)
@@ -76,6 +260,7 @@ namespace Core {
 
     QStringList RecentFileCollection::recentFiles() const {
         Q_D(const RecentFileCollection);
+        d->requestRevalidation();
         return d->recentFiles;
     }
 
@@ -96,12 +281,15 @@ namespace Core {
         if (count < d->recentFiles.size()) {
             for (int i = count; i < d->recentFiles.size(); ++i) {
                 d->cleanupThumbnail(d->recentFiles.at(i));
+                d->recentFileSet.remove(d->recentFiles.at(i));
+                d->unavailableFiles.remove(d->recentFiles.at(i));
             }
             d->recentFiles = d->recentFiles.mid(0, count);
             Q_EMIT recentFilesChanged();
         }
         
         d->count = count;
+        d->thumbnailPack->setCapacity(count);
         Q_EMIT countChanged(count);
         saveSettings();
     }
@@ -109,53 +297,34 @@ namespace Core {
     bool RecentFileCollection::addRecentFile(const QString &path, const QPixmap &thumbnail) {
         Q_D(RecentFileCollection);
         
-        // Check if file exists
-        QFileInfo fileInfo(path);
-        if (!fileInfo.exists()) {
-            qCWarning(lcRecentFileCollection) << "File does not exist:" << path;
-            return false;
-        }
-        
+        // The only resolution of the path, it is empty if the file does not exist
         QString canonicalPath = d->canonicalFilePath(path);
         if (canonicalPath.isEmpty()) {
-            qCWarning(lcRecentFileCollection) << "Failed to get canonical path for:" << path;
+            qCWarning(lcRecentFileCollection) << "File does not exist:" << path;
             return false;
         }
         
         qCInfo(lcRecentFileCollection) << "Adding recent file:" << canonicalPath;
         
         // If file already exists, remove it first
-        int existingIndex = -1;
-        for (int i = 0; i < d->recentFiles.size(); ++i) {
-            if (d->canonicalFilePath(d->recentFiles.at(i)) == canonicalPath) {
-                existingIndex = i;
-                break;
-            }
-        }
-        
-        if (existingIndex >= 0) {
-            d->recentFiles.removeAt(existingIndex);
-            qCDebug(lcRecentFileCollection) << "Removed existing entry at index" << existingIndex;
+        if (d->recentFileSet.contains(canonicalPath)) {
+            d->takeRecentFile(canonicalPath);
+            qCDebug(lcRecentFileCollection) << "Removed existing entry";
         }
         
         // Add to the beginning of the list
         d->recentFiles.prepend(canonicalPath);
+        d->recentFileSet.insert(canonicalPath);
         
         // Save thumbnail
         if (!thumbnail.isNull()) {
-            QString thumbPath = d->thumbnailPath(canonicalPath);
-            if (!thumbPath.isEmpty()) {
-                if (!thumbnail.save(thumbPath, "PNG")) {
-                    qCWarning(lcRecentFileCollection) << "Failed to save thumbnail for:" << canonicalPath;
-                } else {
-                    qCDebug(lcRecentFileCollection) << "Saved thumbnail to:" << thumbPath;
-                }
-            }
+            d->saveThumbnail(canonicalPath, thumbnail);
         }
         
         // Check list length, remove files exceeding the limit
         while (d->recentFiles.size() > d->count) {
-            QString removedFile = d->recentFiles.takeLast();
+            QString removedFile = d->recentFiles.last();
+            d->takeRecentFile(removedFile);
             d->cleanupThumbnail(removedFile);
             qCDebug(lcRecentFileCollection) << "Removed oldest file due to count limit:" << removedFile;
         }
@@ -169,31 +338,14 @@ namespace Core {
     bool RecentFileCollection::removeRecentFile(const QString &path) {
         Q_D(RecentFileCollection);
 
-        QString canonicalPath = d->canonicalFilePath(path);
-        if (canonicalPath.isEmpty()) {
-            // If unable to get canonical path, try direct matching
-            canonicalPath = path;
-        }
-
-        int removeIndex = -1;
-        for (int i = 0; i < d->recentFiles.size(); ++i) {
-            QString itemCanonical = d->canonicalFilePath(d->recentFiles.at(i));
-            if (itemCanonical.isEmpty()) {
-                itemCanonical = d->recentFiles.at(i);
-            }
-
-            if (itemCanonical == canonicalPath) {
-                removeIndex = i;
-                break;
-            }
-        }
-
-        if (removeIndex < 0) {
+        // Entries are matched directly, a path that is not stored is resolved once
+        QString removedFile = d->entryKey(path);
+        if (!d->recentFileSet.contains(removedFile)) {
             qCWarning(lcRecentFileCollection) << "File not found in recent list:" << path;
             return false;
         }
 
-        QString removedFile = d->recentFiles.takeAt(removeIndex);
+        d->takeRecentFile(removedFile);
         d->cleanupThumbnail(removedFile);
 
         qCInfo(lcRecentFileCollection) << "Removed recent file:" << removedFile;
@@ -209,33 +361,119 @@ namespace Core {
         for (auto file : d->recentFiles) {
             d->cleanupThumbnail(file);
         }
-        d->recentFiles.clear();
+        d->setRecentFiles({});
         qCInfo(lcRecentFileCollection) << "Cleared recent files";
         Q_EMIT recentFilesChanged();
         saveSettings();
     }
 
+    /*!
+        Returns the thumbnail of \a path, decoding it if it is not cached. Views should use
+        requestThumbnail() instead, which doesn't block.
+    */
     QPixmap RecentFileCollection::thumbnail(const QString &path) {
-        Q_D(const RecentFileCollection);
+        Q_D(RecentFileCollection);
         
-        QString thumbPath = d->thumbnailPath(path);
-        if (thumbPath.isEmpty()) {
+        const QString entry = d->entryKey(path);
+        if (entry.isEmpty()) {
             return {};
         }
+        if (auto pixmap = d->thumbnailCache.object(entry)) {
+            return *pixmap;
+        }
+
+        // The thumbnail was evicted before it has been written
+        if (d->pendingThumbnailWrites.contains(entry)) {
+            d->thumbnailPool.waitForDone();
+        }
         
-        QPixmap pixmap;
-        if (!pixmap.load(thumbPath)) {
-            qCDebug(lcRecentFileCollection) << "Failed to load thumbnail:" << thumbPath;
+        const QImage image = d->loadThumbnail(entry);
+        if (image.isNull()) {
+            qCDebug(lcRecentFileCollection) << "No thumbnail of:" << entry;
             return {};
         }
+        QPixmap pixmap = QPixmap::fromImage(image);
+        d->thumbnailCache.insert(entry, new QPixmap(pixmap), thumbnailCost(pixmap));
         
         return pixmap;
     }
 
+    /*!
+        Loads the thumbnail of \a path on a worker thread, thumbnailReady() is emitted with
+        \a path when thumbnail() returns it without decoding. Thumbnails are also reported
+        ready when they have been written after addRecentFile(), with the canonical path.
+    */
+    void RecentFileCollection::requestThumbnail(const QString &path) {
+        Q_D(RecentFileCollection);
+
+        const QString entry = d->entryKey(path);
+        if (entry.isEmpty()) {
+            return;
+        }
+        if (d->thumbnailCache.contains(entry)) {
+            QMetaObject::invokeMethod(
+                this, [this, path]() { Q_EMIT thumbnailReady(path); }, Qt::QueuedConnection);
+            return;
+        }
+        if (d->pendingThumbnailLoads.contains(entry)) {
+            return;
+        }
+        d->pendingThumbnailLoads.insert(entry);
+
+        // Queued after the writes, so the slot is complete
+        d->thumbnailPool.start([this, path, entry]() {
+            Q_D(const RecentFileCollection);
+            const QImage image = d->loadThumbnail(entry);
+            if (image.isNull()) {
+                qCDebug(lcRecentFileCollection) << "No thumbnail of:" << entry;
+            }
+            QMetaObject::invokeMethod(
+                this,
+                [this, path, entry, image]() {
+                    Q_D(RecentFileCollection);
+                    d->pendingThumbnailLoads.remove(entry);
+                    if (image.isNull() || !d->recentFileSet.contains(entry)) {
+                        return;
+                    }
+                    // A newer thumbnail may have been added meanwhile
+                    if (!d->thumbnailCache.contains(entry)) {
+                        auto pixmap = new QPixmap(QPixmap::fromImage(image));
+                        d->thumbnailCache.insert(entry, pixmap, thumbnailCost(*pixmap));
+                    }
+                    Q_EMIT thumbnailReady(path);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+
+    /*!
+        Returns an \c image:// URL of the thumbnail of \a path that can be used as the source
+        of an \c Image, or an empty string if there is none. The URL changes when the thumbnail
+        is replaced, read it again on thumbnailReady(). The image is served by the provider
+        that RuntimeInterface::setQmlEngine() installs.
+    */
     QString RecentFileCollection::thumbnailPath(const QString &path) {
+        Q_D(RecentFileCollection);
+        const QString entry = d->entryKey(path);
+        if (entry.isEmpty()) {
+            return {};
+        }
+        if (!d->thumbnailCache.contains(entry) && !d->pendingThumbnailWrites.contains(entry) &&
+            !d->thumbnailPack->contains(entry) &&
+            !(d->hasLegacyThumbnails && QFileInfo::exists(d->legacyThumbnailPath(entry)))) {
+            return {};
+        }
+        return RecentFileThumbnailProvider::url(entry, d->thumbnailRevisions.value(entry));
+    }
+
+    /*!
+        Returns \c false if the entry \a path was found missing by the last revalidation.
+        Entries are revalidated in the background when recentFiles() is read, at most once a
+        minute, and recentFilesChanged() is emitted when their availability changes.
+    */
+    bool RecentFileCollection::isRecentFileAvailable(const QString &path) const {
         Q_D(const RecentFileCollection);
-        QFileInfo fileInfo(d->thumbnailPath(path));
-        return fileInfo.exists() ? fileInfo.absoluteFilePath() : QString();
+        return !d->unavailableFiles.contains(path);
     }
 
     void RecentFileCollection::loadSettings() {
@@ -250,9 +488,13 @@ namespace Core {
         }
         
         settings->beginGroup(staticMetaObject.className());
-        d->recentFiles = settings->value("recentFiles").toStringList();
+        d->setRecentFiles(settings->value("recentFiles").toStringList());
+        d->lastRevalidation.invalidate();
         d->count = settings->value("count", 32).toInt();
         settings->endGroup();
+
+        d->thumbnailPack->setCapacity(d->count);
+        d->importLegacyThumbnails();
         
         qCDebug(lcRecentFileCollection) << "Loaded" << d->recentFiles.size() << "recent files, count limit:" << d->count;
     }
@@ -32,7 +32,9 @@ namespace Core {
         Q_INVOKABLE bool removeRecentFile(const QString &path);
         Q_INVOKABLE void clearRecentFile();
         Q_INVOKABLE QPixmap thumbnail(const QString &path);
+        Q_INVOKABLE void requestThumbnail(const QString &path);
         Q_INVOKABLE QString thumbnailPath(const QString &path);
+        Q_INVOKABLE bool isRecentFileAvailable(const QString &path) const;
 
         void loadSettings();
         void saveSettings() const;
@@ -40,8 +42,11 @@ namespace Core {
     Q_SIGNALS:
         void recentFilesChanged();
         void countChanged(int count);
+        void thumbnailReady(const QString &path);
 
     private:
+        friend class RecentFileThumbnailProvider;
+
         QScopedPointer<RecentFileCollectionPrivate> d_ptr;
     };
 
@@ -3,7 +3,18 @@
 
 #include "recentfilecollection.h"
 
+#include <atomic>
+#include <memory>
+
+#include <QCache>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPixmap>
+#include <QSet>
+#include <QThreadPool>
+
+#include "thumbnailpack_p.h"
 
 namespace Core {
 
@@ -12,16 +23,40 @@ namespace Core {
     public:
         RecentFileCollection *q_ptr;
         
-        QStringList recentFiles;
+        QStringList recentFiles; // Canonical paths, resolved once when added
+        QSet<QString> recentFileSet; // Index of recentFiles
+        QSet<QString> unavailableFiles; // Entries found missing by the last revalidation
         int count = 32; // Default to save 32 recent files
         
-        QString thumbnailDir; // Thumbnail storage directory
+        QString thumbnailDir; // Legacy directory of one PNG per entry, imported into the pack
+        std::atomic_bool hasLegacyThumbnails{false};
+
+        // Thumbnails are stored, loaded and removed in order on a worker thread
+        std::unique_ptr<ThumbnailPack> thumbnailPack;
+        QThreadPool thumbnailPool;
+        QCache<QString, QPixmap> thumbnailCache; // Decoded thumbnails of entries, cost in KiB
+        QSet<QString> pendingThumbnailWrites;
+        QSet<QString> pendingThumbnailLoads;
+        QHash<QString, int> thumbnailRevisions; // Bumped when a thumbnail is written
+
+        // Entries are revalidated in the background when they are read
+        mutable QThreadPool revalidationPool;
+        mutable QElapsedTimer lastRevalidation;
+        mutable bool revalidating = false;
         
         void init();
-        QString thumbnailPath(const QString &filePath) const;
+        QString legacyThumbnailPath(const QString &entry) const;
         QString canonicalFilePath(const QString &path) const;
-        void ensureThumbnailDir();
-        void cleanupThumbnail(const QString &filePath);
+        QString entryKey(const QString &path) const;
+        void setRecentFiles(const QStringList &files);
+        void takeRecentFile(const QString &entry);
+        void cleanupThumbnail(const QString &entry);
+        void saveThumbnail(const QString &entry, const QPixmap &thumbnail);
+        void renameThumbnail(const QString &entry, const QString &newEntry);
+        QImage loadThumbnail(const QString &entry) const;
+        void importLegacyThumbnails();
+        void requestRevalidation() const;
+        void applyRevalidation(const QStringList &files, const QStringList &canonicalPaths);
     };
 
 }
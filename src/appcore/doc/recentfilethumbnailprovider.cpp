@@ -0,0 +1,47 @@
+#include "recentfilethumbnailprovider_p.h"
+
+#include <QUrl>
+
+#include <CoreApi/coreinterfacebase.h>
+
+#include "recentfilecollection_p.h"
+
+namespace Core {
+
+    RecentFileThumbnailProvider::RecentFileThumbnailProvider()
+        : QQuickImageProvider(QQuickImageProvider::Image) {
+    }
+
+    QString RecentFileThumbnailProvider::providerId() {
+        return QStringLiteral("recentfilethumbnails");
+    }
+
+    // The revision changes when the thumbnail is replaced, so that Image items reload it
+    // instead of showing the cached one
+    QString RecentFileThumbnailProvider::url(const QString &entry, int revision) {
+        return QStringLiteral("image://%1/%2/%3")
+            .arg(providerId(), QString::number(revision),
+                 QString::fromLatin1(QUrl::toPercentEncoding(entry)));
+    }
+
+    QImage RecentFileThumbnailProvider::requestImage(const QString &id, QSize *size,
+                                                     const QSize &requestedSize) {
+        if (!CoreInterfaceBase::instance()) {
+            return {};
+        }
+        const QString entry = QUrl::fromPercentEncoding(id.section(QLatin1Char('/'), 1).toLatin1());
+        QImage image = CoreInterfaceBase::recentFileCollection()->d_func()->loadThumbnail(entry);
+        if (image.isNull()) {
+            return {};
+        }
+        if (size) {
+            *size = image.size();
+        }
+        if (requestedSize.width() > 0 && requestedSize.height() > 0 &&
+            (image.width() > requestedSize.width() || image.height() > requestedSize.height())) {
+            image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+        return image;
+    }
+
+}
@@ -0,0 +1,23 @@
+#ifndef CHORUSKIT_RECENTFILETHUMBNAILPROVIDER_P_H
+#define CHORUSKIT_RECENTFILETHUMBNAILPROVIDER_P_H
+
+#include <QQuickImageProvider>
+
+namespace Core {
+
+    // Serves the thumbnails of the recent files to QML, as RecentFileCollection::thumbnailPath()
+    // URLs. The image is read from the thumbnail pack, which is thread-safe, so it can be
+    // requested from the image loader thread.
+    class RecentFileThumbnailProvider : public QQuickImageProvider {
+    public:
+        RecentFileThumbnailProvider();
+
+        static QString providerId();
+        static QString url(const QString &entry, int revision);
+
+        QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize) override;
+    };
+
+}
+
+#endif // CHORUSKIT_RECENTFILETHUMBNAILPROVIDER_P_H
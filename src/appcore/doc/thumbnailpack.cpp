@@ -0,0 +1,345 @@
+#include "thumbnailpack_p.h"
+#include "advisorylock_p.h"
+#include "xxhash64_p.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QLoggingCategory>
+#include <QSaveFile>
+
+namespace Core {
+
+    Q_STATIC_LOGGING_CATEGORY(lcThumbnailPack, "ck.thumbnailpack")
+
+    static constexpr quint32 PACK_MAGIC = 0x434b5450; // CKTP
+    static constexpr quint32 PACK_VERSION = 1;
+
+    struct PackHeader {
+        quint32 magic;
+        quint32 version;
+        quint32 slotWidth;
+        quint32 slotHeight;
+        quint32 slotCount;
+        quint32 reserved[11];
+    };
+
+    struct SlotHeader {
+        quint64 key; // Zero if the slot is free
+        quint32 width;
+        quint32 height;
+        quint64 stamp; // Order of the stores, the oldest slot is reused first
+        quint64 reserved;
+    };
+
+    static_assert(sizeof(PackHeader) == 64);
+    static_assert(sizeof(SlotHeader) == 32);
+
+    static constexpr qint64 SLOT_PIXELS_SIZE =
+        qint64(ThumbnailPack::SlotWidth) * ThumbnailPack::SlotHeight * 4;
+    static constexpr qint64 SLOT_SIZE = sizeof(SlotHeader) + SLOT_PIXELS_SIZE;
+
+    static qint64 packSize(int slotCount) {
+        return qint64(sizeof(PackHeader)) + slotCount * SLOT_SIZE;
+    }
+
+    static SlotHeader *slotHeader(uchar *address, int slot) {
+        return reinterpret_cast<SlotHeader *>(address + sizeof(PackHeader) + slot * SLOT_SIZE);
+    }
+
+    static uchar *slotPixels(uchar *address, int slot) {
+        return address + sizeof(PackHeader) + slot * SLOT_SIZE + sizeof(SlotHeader);
+    }
+
+    static quint64 slotKey(const QString &entry) {
+        // Zero marks free slots
+        return xxHash64(entry.toUtf8()) | 1;
+    }
+
+    static bool hasValidSize(const SlotHeader *header) {
+        return header->width > 0 && header->width <= quint32(ThumbnailPack::SlotWidth) &&
+               header->height > 0 && header->height <= quint32(ThumbnailPack::SlotHeight);
+    }
+
+    // Blocking lock of the pack shared by the processes using it, released by the OS if the
+    // process dies. File systems without locks leave the processes unsynchronized
+    class PackLocker {
+    public:
+        PackLocker(const QFile &file, bool exclusive) : m_handle(file.handle()), m_locked(false) {
+            if (m_handle < 0) {
+                return;
+            }
+            m_locked = AdvisoryLock::lockHandle(m_handle,
+                                                exclusive ? FileLocker::ExclusiveLock
+                                                          : FileLocker::SharedLock,
+                                                true) == AdvisoryLock::NativeLocked;
+        }
+
+        ~PackLocker() {
+            if (m_locked) {
+                AdvisoryLock::unlockHandle(m_handle);
+            }
+        }
+
+    private:
+        int m_handle;
+        bool m_locked;
+
+        Q_DISABLE_COPY(PackLocker)
+    };
+
+    ThumbnailPack::ThumbnailPack(const QString &filePath)
+        : m_file(filePath), m_address(nullptr), m_slotCount(0), m_stamp(0) {
+    }
+
+    ThumbnailPack::~ThumbnailPack() {
+        QMutexLocker locker(&m_mutex);
+        unmapFile();
+    }
+
+    bool ThumbnailPack::open(int capacity) {
+        QMutexLocker locker(&m_mutex);
+        unmapFile();
+        m_file.close();
+
+        for (int attempt = 0;; ++attempt) {
+            if (!m_file.open(QIODevice::ReadWrite)) {
+                qCWarning(lcThumbnailPack) << "Failed to open thumbnail pack:"
+                                           << m_file.fileName() << m_file.errorString();
+                return false;
+            }
+
+            {
+                PackLocker packLocker(m_file, true);
+
+                // Keep the slots of a valid pack, even beyond the capacity
+                int slotCount = 0;
+                PackHeader header;
+                if (m_file.read(reinterpret_cast<char *>(&header), sizeof(header)) ==
+                        sizeof(header) &&
+                    header.magic == PACK_MAGIC && header.version == PACK_VERSION &&
+                    header.slotWidth == quint32(SlotWidth) &&
+                    header.slotHeight == quint32(SlotHeight) &&
+                    m_file.size() >= packSize(int(header.slotCount))) {
+                    slotCount = int(header.slotCount);
+                }
+                if (slotCount > 0 || m_file.size() == 0) {
+                    return mapFile(std::max({slotCount, std::min(capacity, MaxSlotCount), 1}));
+                }
+            }
+            m_file.close();
+
+            // Other instances may still map a pack of another layout, truncating it would make
+            // their accesses fault. It is replaced by a new file, they keep the old one
+            qCInfo(lcThumbnailPack) << "Recreating thumbnail pack:" << m_file.fileName();
+            QSaveFile newFile(m_file.fileName());
+            if (attempt > 0 || !newFile.open(QIODevice::WriteOnly) || !newFile.commit()) {
+                qCWarning(lcThumbnailPack) << "Failed to recreate thumbnail pack:"
+                                           << m_file.fileName() << newFile.errorString();
+                return false;
+            }
+        }
+    }
+
+    bool ThumbnailPack::setCapacity(int capacity) {
+        QMutexLocker locker(&m_mutex);
+        capacity = std::min(capacity, MaxSlotCount);
+        if (!m_address || capacity <= m_slotCount) {
+            return m_address != nullptr;
+        }
+        PackLocker packLocker(m_file, true);
+        unmapFile();
+        return mapFile(capacity);
+    }
+
+    bool ThumbnailPack::contains(const QString &entry) const {
+        QMutexLocker locker(&m_mutex);
+        PackLocker packLocker(m_file, false);
+        return findSlot(slotKey(entry)) >= 0;
+    }
+
+    // Returns a copy, the slot may be reused once the lock is released
+    QImage ThumbnailPack::image(const QString &entry) const {
+        QMutexLocker locker(&m_mutex);
+        PackLocker packLocker(m_file, false);
+        const int slot = findSlot(slotKey(entry));
+        if (slot < 0) {
+            return {};
+        }
+        const auto header = slotHeader(m_address, slot);
+        const QImage view(slotPixels(m_address, slot), int(header->width), int(header->height),
+                          int(header->width) * 4, QImage::Format_ARGB32_Premultiplied);
+        return view.copy();
+    }
+
+    /*!
+        Stores \a image scaled down to fit a slot. The slot of the entry is overwritten,
+        otherwise a free slot or the least recently stored one is used.
+    */
+    bool ThumbnailPack::store(const QString &entry, const QImage &image) {
+        // Converted before locking, readers are not blocked by the scaling
+        QImage pixels = image;
+        if (pixels.width() > SlotWidth || pixels.height() > SlotHeight) {
+            pixels = pixels.scaled(SlotWidth, SlotHeight, Qt::KeepAspectRatio,
+                                   Qt::SmoothTransformation);
+        }
+        pixels.convertTo(QImage::Format_ARGB32_Premultiplied);
+        if (pixels.isNull()) {
+            return false;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        if (!m_address) {
+            return false;
+        }
+        PackLocker packLocker(m_file, true);
+
+        // Catch up with the stores of the other processes, including their stamps
+        loadIndex();
+
+        const quint64 key = slotKey(entry);
+        int slot = m_index.value(key, -1);
+        if (slot < 0) {
+            slot = findFreeSlot();
+        }
+        auto header = slotHeader(m_address, slot);
+        if (header->key != 0 && header->key != key) {
+            m_index.remove(header->key);
+        }
+
+        // Invalid while being written
+        header->key = 0;
+        const qsizetype rowSize = qsizetype(pixels.width()) * 4;
+        for (int y = 0; y < pixels.height(); ++y) {
+            std::memcpy(slotPixels(m_address, slot) + y * rowSize, pixels.constScanLine(y),
+                        size_t(rowSize));
+        }
+        header->width = quint32(pixels.width());
+        header->height = quint32(pixels.height());
+        header->stamp = ++m_stamp;
+        header->key = key;
+
+        m_index.insert(key, slot);
+        return true;
+    }
+
+    void ThumbnailPack::remove(const QString &entry) {
+        QMutexLocker locker(&m_mutex);
+        PackLocker packLocker(m_file, true);
+        const quint64 key = slotKey(entry);
+        const int slot = findSlot(key);
+        if (slot < 0) {
+            return;
+        }
+        slotHeader(m_address, slot)->key = 0;
+        m_index.remove(key);
+    }
+
+    void ThumbnailPack::rename(const QString &entry, const QString &newEntry) {
+        QMutexLocker locker(&m_mutex);
+        PackLocker packLocker(m_file, true);
+        const quint64 key = slotKey(entry);
+        const int slot = findSlot(key);
+        if (slot < 0) {
+            return;
+        }
+
+        const quint64 newKey = slotKey(newEntry);
+        if (newKey == key) {
+            return;
+        }
+        if (const int oldSlot = findSlot(newKey); oldSlot >= 0) {
+            slotHeader(m_address, oldSlot)->key = 0;
+        }
+        slotHeader(m_address, slot)->key = newKey;
+        m_index.remove(key);
+        m_index.insert(newKey, slot);
+    }
+
+    bool ThumbnailPack::mapFile(int slotCount) {
+        // Added slots are zero filled, which marks them free
+        if (m_file.size() < packSize(slotCount) && !m_file.resize(packSize(slotCount))) {
+            qCWarning(lcThumbnailPack)
+                << "Failed to resize thumbnail pack:" << m_file.errorString();
+            return false;
+        }
+
+        m_address = m_file.map(0, packSize(slotCount));
+        if (!m_address) {
+            qCWarning(lcThumbnailPack) << "Failed to map thumbnail pack:" << m_file.errorString();
+            return false;
+        }
+        m_slotCount = slotCount;
+
+        auto packHeader = reinterpret_cast<PackHeader *>(m_address);
+        packHeader->magic = PACK_MAGIC;
+        packHeader->version = PACK_VERSION;
+        packHeader->slotWidth = SlotWidth;
+        packHeader->slotHeight = SlotHeight;
+        // Another process may use more slots than this one
+        packHeader->slotCount = std::max(packHeader->slotCount, quint32(slotCount));
+
+        m_stamp = 0;
+        loadIndex();
+
+        // Free the slots left out of the index, their size is invalid or their key duplicated
+        for (int slot = 0; slot < slotCount; ++slot) {
+            auto header = slotHeader(m_address, slot);
+            if (header->key != 0 && m_index.value(header->key, -1) != slot) {
+                header->key = 0;
+            }
+        }
+        return true;
+    }
+
+    void ThumbnailPack::unmapFile() {
+        if (m_address) {
+            m_file.unmap(m_address);
+            m_address = nullptr;
+        }
+        m_slotCount = 0;
+        m_index.clear();
+    }
+
+    // The index is built from the slot headers, touching one page per slot
+    void ThumbnailPack::loadIndex() const {
+        m_index.clear();
+        for (int slot = 0; slot < m_slotCount; ++slot) {
+            const auto header = slotHeader(m_address, slot);
+            if (header->key == 0 || !hasValidSize(header) || m_index.contains(header->key)) {
+                continue;
+            }
+            m_index.insert(header->key, slot);
+            m_stamp = std::max(m_stamp, header->stamp);
+        }
+    }
+
+    int ThumbnailPack::findSlot(quint64 key) const {
+        const int slot = m_index.value(key, -1);
+        if (slot >= 0) {
+            const auto header = slotHeader(m_address, slot);
+            if (header->key == key && hasValidSize(header)) {
+                return slot;
+            }
+        }
+
+        // Reused, moved or stored by another process
+        loadIndex();
+        return m_index.value(key, -1);
+    }
+
+    int ThumbnailPack::findFreeSlot() const {
+        int oldest = 0;
+        for (int slot = 0; slot < m_slotCount; ++slot) {
+            const auto header = slotHeader(m_address, slot);
+            if (header->key == 0) {
+                return slot;
+            }
+            if (header->stamp < slotHeader(m_address, oldest)->stamp) {
+                oldest = slot;
+            }
+        }
+        return oldest;
+    }
+
+}
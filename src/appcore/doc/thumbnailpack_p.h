@@ -0,0 +1,59 @@
+#ifndef CHORUSKIT_THUMBNAILPACK_P_H
+#define CHORUSKIT_THUMBNAILPACK_P_H
+
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+
+namespace Core {
+
+    // Thumbnails of the recent files in one memory-mapped file of fixed-size slots. Each slot
+    // holds a header, keyed by the hash of the entry, and premultiplied ARGB pixels that are
+    // used without decoding. The pack is a cache in native byte order, it is recreated if its
+    // layout doesn't match. All functions are thread-safe, and processes sharing the pack
+    // serialize on a lock of the file.
+    class ThumbnailPack {
+    public:
+        static constexpr int SlotWidth = 256;
+        static constexpr int SlotHeight = 256;
+
+        // Upper bound of the slots a pack grows to, each takes 256 KiB that are not sparse
+        // on every file system. Beyond it the least recently stored thumbnails are reused
+        static constexpr int MaxSlotCount = 64;
+
+        explicit ThumbnailPack(const QString &filePath);
+        ~ThumbnailPack();
+
+        bool open(int capacity);
+        bool setCapacity(int capacity);
+
+        bool contains(const QString &entry) const;
+        QImage image(const QString &entry) const;
+        bool store(const QString &entry, const QImage &image);
+        void remove(const QString &entry);
+        void rename(const QString &entry, const QString &newEntry);
+
+    private:
+        mutable QMutex m_mutex;
+        QFile m_file;
+        uchar *m_address;
+        int m_slotCount;
+        mutable quint64 m_stamp;
+
+        // Other processes store into the pack too, the index is a hint checked against the slot
+        // headers and rebuilt when it is stale
+        mutable QHash<quint64, int> m_index;
+
+        bool mapFile(int slotCount);
+        void unmapFile();
+        void loadIndex() const;
+        int findSlot(quint64 key) const;
+        int findFreeSlot() const;
+
+        Q_DISABLE_COPY(ThumbnailPack)
+    };
+
+}
+
+#endif // CHORUSKIT_THUMBNAILPACK_P_H
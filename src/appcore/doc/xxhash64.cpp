@@ -0,0 +1,80 @@
+#include "xxhash64_p.h"
+
+#include <QtEndian>
+
+namespace Core {
+
+    static constexpr quint64 PRIME1 = 0x9e3779b185ebca87ULL;
+    static constexpr quint64 PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+    static constexpr quint64 PRIME3 = 0x165667b19e3779f9ULL;
+    static constexpr quint64 PRIME4 = 0x85ebca77c2b2ae63ULL;
+    static constexpr quint64 PRIME5 = 0x27d4eb2f165667c5ULL;
+
+    static inline quint64 rotl(quint64 x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static inline quint64 accumulate(quint64 acc, quint64 input) {
+        acc += input * PRIME2;
+        acc = rotl(acc, 31);
+        return acc * PRIME1;
+    }
+
+    static inline quint64 mergeRound(quint64 acc, quint64 value) {
+        acc ^= accumulate(0, value);
+        return acc * PRIME1 + PRIME4;
+    }
+
+    quint64 xxHash64(QByteArrayView data, quint64 seed) {
+        auto p = reinterpret_cast<const uchar *>(data.data());
+        const auto end = p + data.size();
+        quint64 h;
+
+        if (data.size() >= 32) {
+            quint64 v1 = seed + PRIME1 + PRIME2;
+            quint64 v2 = seed + PRIME2;
+            quint64 v3 = seed;
+            quint64 v4 = seed - PRIME1;
+            const auto limit = end - 32;
+            do {
+                v1 = accumulate(v1, qFromLittleEndian<quint64>(p));
+                v2 = accumulate(v2, qFromLittleEndian<quint64>(p + 8));
+                v3 = accumulate(v3, qFromLittleEndian<quint64>(p + 16));
+                v4 = accumulate(v4, qFromLittleEndian<quint64>(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = mergeRound(h, v1);
+            h = mergeRound(h, v2);
+            h = mergeRound(h, v3);
+            h = mergeRound(h, v4);
+        } else {
+            h = seed + PRIME5;
+        }
+
+        h += quint64(data.size());
+
+        for (; p + 8 <= end; p += 8) {
+            h ^= accumulate(0, qFromLittleEndian<quint64>(p));
+            h = rotl(h, 27) * PRIME1 + PRIME4;
+        }
+        if (p + 4 <= end) {
+            h ^= quint64(qFromLittleEndian<quint32>(p)) * PRIME1;
+            h = rotl(h, 23) * PRIME2 + PRIME3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= quint64(*p) * PRIME5;
+            h = rotl(h, 11) * PRIME1;
+        }
+
+        h ^= h >> 33;
+        h *= PRIME2;
+        h ^= h >> 29;
+        h *= PRIME3;
+        h ^= h >> 32;
+        return h;
+    }
+
+}
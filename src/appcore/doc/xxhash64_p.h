@@ -0,0 +1,13 @@
+#ifndef CHORUSKIT_XXHASH64_P_H
+#define CHORUSKIT_XXHASH64_P_H
+
+#include <QByteArrayView>
+
+namespace Core {
+
+    // XXH64 of Yann Collet's xxHash, a non-cryptographic hash running at memory bandwidth
+    quint64 xxHash64(QByteArrayView data, quint64 seed = 0);
+
+}
+
+#endif // CHORUSKIT_XXHASH64_P_H
@@ -50,7 +50,19 @@ namespace Core {
                     }
                     if (d->closeAsExit && event->isAccepted()) {
                         w->deleteLater();
-                        d->quit();
+                        if (!d->loadingAddOns) {
+                            d->quit();
+                            break;
+                        }
+
+                        // Quitting waits for the add-ons, not inside the window's event delivery
+                        QMetaObject::invokeMethod(
+                            d,
+                            [d = d]() {
+                                if (d->state < ExecutiveInterface::Exiting)
+                                    d->quit();
+                            },
+                            Qt::QueuedConnection);
                     }
                     break;
                 default:
@@ -44,6 +44,9 @@ namespace Loader {
         virtual QSettings *createChorusKitSettings(QSettings::Scope scope);
  
         /// Parse extra options and do some initializations
+        /// \note \a arguments only contains the program name and the options declared in
+        /// \c extraArguments with their parameters, remove the handled ones, the rest is passed
+        /// to the plugin manager
         virtual bool preprocessArguments(QStringList &arguments, int *code = nullptr);
 
         /// Show text on splash
@@ -57,6 +57,13 @@ static const char PLUGIN_PATH_OPTION[] = "--plugin-path";
 // Optional arguments
 static const char ALLOW_ROOT_OPTION[] = "--allow-root";
 
+// Leading mark of the raw arguments sent by a secondary instance
+static const quint32 REMOTE_MESSAGE_MAGIC = 0x434b524d; // CKRM
+
+// The primary instance acknowledges messages from its event loop, which does not run while it is
+// still loading plugins
+static const int REMOTE_MESSAGE_STARTUP_TIMEOUT = 30000;
+
 // Global variables
 static QSplashScreen *g_splash = nullptr;
 static LoaderSpec *g_loadSpec = nullptr;
@@ -180,36 +187,276 @@ static inline QString msgCoreLoadFailure(const QString &why) {
 
 namespace {
 
+    // Classifies every argument once and hands each consumer its slice
     class ArgumentParser {
     public:
+        enum OptionKind {
+            AllowRoot,
+            PluginPath,
+            Help,
+            Version,
+            SpecOption,
+        };
+
+        struct Option {
+            OptionKind kind;
+            bool hasParam;
+        };
+
         bool allowRoot;
         bool showHelp;
+        bool showVersion;
         QStringList customPluginPaths;
 
-        ArgumentParser() : allowRoot(false), showHelp(false) {
+        // Program name and the options of LoaderSpec::extraArguments with their parameters
+        QStringList specArguments;
+
+        // Program name and everything else, parsed by the plugin manager
+        QStringList pluginArguments;
+
+        // Positions of the arguments of both slices on the command line
+        QList<qsizetype> specPositions;
+        QList<qsizetype> pluginPositions;
+
+        ArgumentParser() : allowRoot(false), showHelp(false), showVersion(false) {
+            if (!g_loadSpec->allowRoot) {
+                addOption(QLatin1String(ALLOW_ROOT_OPTION), AllowRoot, false);
+            }
+            addOption(QLatin1String(PLUGIN_PATH_OPTION), PluginPath, true);
+            addOption(QLatin1String(HELP_OPTION1), Help, false);
+            addOption(QLatin1String(HELP_OPTION2), Help, false);
+            addOption(QLatin1String(VERSION_OPTION1), Version, false);
+            addOption(QLatin1String(VERSION_OPTION2), Version, false);
+
+            for (const auto &item : std::as_const(g_loadSpec->extraArguments)) {
+                for (const auto &option : item.options) {
+                    addOption(option, SpecOption, !item.param.isEmpty());
+                }
+            }
+        }
+
+        void addOption(const QString &name, OptionKind kind, bool hasParam) {
+            m_options.insert(name, {kind, hasParam});
         }
 
-        void parse(QStringList &arguments) {
-            QMutableStringListIterator it(arguments);
-            while (it.hasNext()) {
-                const QString &arg = it.next();
-                if (!g_loadSpec->allowRoot && arg == QLatin1String(ALLOW_ROOT_OPTION)) {
-                    it.remove();
-                    allowRoot = true;
-                } else if (arg == QLatin1String(PLUGIN_PATH_OPTION)) {
-                    it.remove();
-                    if (it.hasNext()) {
-                        customPluginPaths << it.next();
-                        it.remove();
+        void parse(const QStringList &arguments) {
+            if (arguments.isEmpty()) {
+                return;
+            }
+
+            specArguments = {arguments.front()};
+            specPositions = {0};
+            pluginArguments.reserve(arguments.size());
+            pluginPositions.reserve(arguments.size());
+            addPluginArgument(arguments.front(), 0);
+
+            const auto size = arguments.size();
+            for (qsizetype i = 1; i < size; ++i) {
+                const QString &arg = arguments.at(i);
+
+                // Files are the common case of a long command line
+                if (!arg.startsWith(QLatin1Char('-'))) {
+                    addPluginArgument(arg, i);
+                    continue;
+                }
+
+                auto it = m_options.constFind(arg);
+                if (it == m_options.cend()) {
+                    // Unknown options belong to plugins, so does the following parameter if any
+                    addPluginArgument(arg, i);
+                    if (i + 1 < size && !m_options.contains(arguments.at(i + 1))) {
+                        ++i;
+                        addPluginArgument(arguments.at(i), i);
                     }
-                } else if (arg == HELP_OPTION1 || arg == HELP_OPTION2) {
-                    showHelp = true;
-                } else if (arg.startsWith('-')) {
-                    if (it.hasNext()) {
-                        it.next();
+                    continue;
+                }
+
+                switch (it->kind) {
+                    case AllowRoot:
+                        allowRoot = true;
+                        break;
+                    case PluginPath:
+                        if (i + 1 < size) {
+                            customPluginPaths.append(arguments.at(++i));
+                        }
+                        break;
+                    case Help:
+                        showHelp = true;
+                        break;
+                    case Version:
+                        showVersion = true;
+                        break;
+                    case SpecOption:
+                        addSpecArgument(arg, i);
+                        if (it->hasParam && i + 1 < size) {
+                            ++i;
+                            addSpecArgument(arguments.at(i), i);
+                        }
+                        break;
+                }
+            }
+        }
+
+        // Puts the arguments that LoaderSpec::preprocessArguments() left in \a remaining back
+        // to their positions among the plugin arguments, arguments added by the spec go last
+        void restoreSpecArguments(const QStringList &remaining) {
+            QStringList result;
+            QStringList added;
+            result.reserve(pluginArguments.size() + remaining.size());
+
+            qsizetype pluginIndex = 0;
+            qsizetype specIndex = 1;
+            for (qsizetype i = 1; i < remaining.size(); ++i) {
+                const QString &arg = remaining.at(i);
+                const auto found = specArguments.indexOf(arg, specIndex);
+                if (found < 0) {
+                    added.append(arg);
+                    continue;
+                }
+                specIndex = found + 1;
+
+                const auto position = specPositions.at(found);
+                while (pluginIndex < pluginArguments.size() &&
+                       pluginPositions.at(pluginIndex) < position) {
+                    result.append(pluginArguments.at(pluginIndex++));
+                }
+                result.append(arg);
+            }
+            result.append(pluginArguments.mid(pluginIndex));
+            result.append(added);
+
+            pluginArguments = result;
+            pluginPositions.clear();
+        }
+
+    private:
+        QHash<QString, Option> m_options;
+
+        void addSpecArgument(const QString &arg, qsizetype position) {
+            specArguments.append(arg);
+            specPositions.append(position);
+        }
+
+        void addPluginArgument(const QString &arg, qsizetype position) {
+            pluginArguments.append(arg);
+            pluginPositions.append(position);
+        }
+    };
+
+    // Translates the raw arguments of a secondary instance to the serialized format of
+    // PluginManager::serializedArguments() and forwards them to plugins
+    class RemoteMessageHandler {
+    public:
+        bool pluginsLoaded;
+        QList<QPair<quint32, QByteArray>> pendingMessages;
+
+        RemoteMessageHandler() : pluginsLoaded(false) {
+        }
+
+        void handle(quint32 instanceId, QByteArray message) const {
+            QDataStream stream(&message, QIODevice::ReadOnly);
+
+            QString msg;
+            quint32 magic = 0;
+            stream >> magic;
+            if (magic == REMOTE_MESSAGE_MAGIC) {
+                QString workingDirectory;
+                QStringList arguments;
+                stream >> workingDirectory >> arguments;
+                msg = serializeArguments(workingDirectory, arguments);
+            } else {
+                // Serialized arguments sent by an older loader
+                QDataStream legacyStream(&message, QIODevice::ReadOnly);
+                legacyStream >> msg;
+            }
+
+            qCDebug(ckLoader).noquote().nospace()
+                << " remote message from " << instanceId << ", " << msg;
+            PluginManager::remoteArguments(msg, nullptr);
+        }
+
+        static QString serializeArguments(const QString &workingDirectory,
+                                          const QStringList &rawArguments) {
+            ArgumentParser argsParser;
+            argsParser.parse(rawArguments);
+
+            // Options of plugins
+            QHash<QString, QPair<PluginSpec *, bool>> pluginOptions;
+            for (const auto spec : PluginManager::plugins()) {
+                for (const auto &desc : spec->argumentDescriptions()) {
+                    pluginOptions.insert(desc.name, {spec, !desc.parameter.isEmpty()});
+                }
+            }
+
+            // Options of the plugin manager, they don't affect a running instance
+            static const QHash<QString, bool> managerOptions = pluginManagerOptions();
+
+            QList<PluginSpec *> specs;
+            QHash<PluginSpec *, QStringList> specArguments;
+            QStringList freeArguments;
+
+            const auto &arguments = argsParser.pluginArguments;
+            const auto size = arguments.size();
+            for (qsizetype i = 1; i < size; ++i) {
+                const QString &arg = arguments.at(i);
+                if (!arg.startsWith(QLatin1Char('-'))) {
+                    freeArguments.append(arg);
+                    continue;
+                }
+
+                if (auto it = pluginOptions.constFind(arg); it != pluginOptions.cend()) {
+                    auto spec = it->first;
+                    if (!specArguments.contains(spec)) {
+                        specs.append(spec);
                     }
+                    auto &list = specArguments[spec];
+                    list.append(arg);
+                    if (it->second && i + 1 < size) {
+                        list.append(arguments.at(++i));
+                    }
+                } else if (auto it2 = managerOptions.constFind(arg);
+                           it2 != managerOptions.cend()) {
+                    if (it2.value() && i + 1 < size) {
+                        ++i;
+                    }
+                } else {
+                    qCWarning(ckLoader) << "ignored unknown remote option" << arg;
                 }
             }
+
+            // The format parsed by PluginManager::remoteArguments()
+            const QChar separator = QLatin1Char('|');
+            QString res;
+            for (const auto spec : std::as_const(specs)) {
+                if (!res.isEmpty())
+                    res += separator;
+                res += QLatin1Char(':') + spec->name() + separator +
+                       specArguments.value(spec).join(separator);
+            }
+            if (!res.isEmpty())
+                res += separator;
+            res += QLatin1String(":pwd") + separator + workingDirectory;
+            if (!freeArguments.isEmpty()) {
+                res += separator + QLatin1String(":arguments");
+                for (const auto &arg : std::as_const(freeArguments)) {
+                    res += separator + arg;
+                }
+            }
+            return res;
+        }
+
+        // Options parsed by ExtensionSystem::Internal::OptionsParser and whether they take a
+        // parameter, keep in sync with PluginManager::formatOptions()
+        static QHash<QString, bool> pluginManagerOptions() {
+            return {
+                {QStringLiteral("-load"), true},
+                {QStringLiteral("-noload"), true},
+                {QStringLiteral("-profile"), false},
+                {QStringLiteral("-nocrashcheck"), false},
+                {QStringLiteral("-test"), true},
+                {QStringLiteral("-notest"), true},
+                {QStringLiteral("-scenario"), true},
+            };
         }
     };
 
@@ -221,13 +468,51 @@ int __main__(LoaderSpec *loadSpec) {
     // Global instances must be created
     QApplication &a = *qApp;
 
-    QStringList arguments = a.arguments();
     ArgumentParser argsParser;
+    argsParser.parse(a.arguments());
+
+    // Hand the arguments over to the running instance before any heavy initialization
+    std::optional<SingleApplication> singleHook;
+    RemoteMessageHandler remoteHandler;
+    if (loadSpec->single && !argsParser.showHelp && !argsParser.showVersion) {
+        // Initialize singleton handle
+        singleHook.emplace(qApp, true, opts);
+        if (auto &single = *singleHook; !single.isPrimary()) {
+            qCDebug(ckLoader) << "primary instance already running. PID:" << single.primaryPid();
+
+            // Send raw arguments, the primary instance knows the plugin options
+            QByteArray buffer;
+            QDataStream stream(&buffer, QIODevice::WriteOnly);
+            stream << REMOTE_MESSAGE_MAGIC << QDir::currentPath() << a.arguments();
+            // Give a starting primary instance time to acknowledge, the message stays queued
+            // and its shared payload mapped until then
+            if (!single.sendMessage(buffer) &&
+                !single.flushMessages(REMOTE_MESSAGE_STARTUP_TIMEOUT)) {
+                qCCritical(ckLoader) << "primary instance didn't acknowledge the arguments"
+                                     << a.arguments().mid(1);
+                return 1;
+            }
+
+            qCDebug(ckLoader) << "secondary instance closing...";
+
+            return 0;
+        } else {
+            qCDebug(ckLoader) << "primary instance initializing...";
+        }
+
+        // Set up remote arguments handler, messages are queued until plugins are loaded
+        QObject::connect(&singleHook.value(), &SingleApplication::receivedMessage,
+                         [&remoteHandler](quint32 instanceId, const QByteArray &message) {
+                             if (!remoteHandler.pluginsLoaded) {
+                                 remoteHandler.pendingMessages.append({instanceId, message});
+                                 return;
+                             }
+                             remoteHandler.handle(instanceId, message);
+                         });
+    }
 
     // Process command line arguments
     {
-        argsParser.parse(arguments);
-
         // Root privilege detection
         if (!g_loadSpec->allowRoot && !argsParser.allowRoot && !argsParser.showHelp &&
             ApplicationInfo::isUserRoot()) {
@@ -249,9 +534,13 @@ int __main__(LoaderSpec *loadSpec) {
 
         // If you need to show help, we simply ignore this error and continue loading plugins
         int code = -1;
-        if (!loadSpec->preprocessArguments(arguments, &code) && !argsParser.showHelp) {
+        QStringList specArguments = argsParser.specArguments;
+        if (!loadSpec->preprocessArguments(specArguments, &code) && !argsParser.showHelp) {
             return code;
         }
+
+        // Arguments left by the spec are passed on to plugins in their original order
+        argsParser.restoreSpecArguments(specArguments);
     }
 
     // QtCreator ExtensionSystem plugin manager
@@ -271,30 +560,30 @@ int __main__(LoaderSpec *loadSpec) {
     runtimeInterface.setSplash(&splash);
     loadSpec->splashWillShow(&splash);
 
-    splash.applyConfig(loadSpec->splashConfigPath);
+    splash.applyConfig(loadSpec->splashConfigPath,
+                       QStringLiteral("%1/%2.splashcache")
+                           .arg(ApplicationInfo::applicationLocation(ApplicationInfo::RuntimeData),
+                                QCoreApplication::applicationName()));
     splash.show();
 
-    // QFontDatabase needs a lot of time to initialize, so we show splash first and then show texts
+    // QFontDatabase needs a lot of time to initialize, the splash warms it up in a worker thread
+    // and shows the texts as soon as it's ready
     splash.showTexts();
 
     loadSpec->splashShown(&splash);
 
     // Update loader text
-    splash.showMessage(QCoreApplication::translate("Application", "Searching plugins..."));
+    splash.showStatus(QCoreApplication::translate("Application", "Searching plugins..."));
 
     QStringList pluginPaths = loadSpec->pluginPaths + argsParser.customPluginPaths;
     pluginManager.setPluginPaths(pluginPaths);
 
-    // Parse arguments again
-    QMap<QString, QString> foundAppOptions;
-    if (arguments.size() > 1) {
-        QMap<QString, bool> appOptions;
-        appOptions.insert(QLatin1String(HELP_OPTION1), false);
-        appOptions.insert(QLatin1String(HELP_OPTION2), false);
-        appOptions.insert(QLatin1String(VERSION_OPTION1), false);
-        appOptions.insert(QLatin1String(VERSION_OPTION2), false);
+    // Parse plugin options, application options have been consumed already
+    if (argsParser.pluginArguments.size() > 1) {
+        QMap<QString, QString> foundAppOptions;
         QString errorMessage;
-        if (!PluginManager::parseOptions(arguments, appOptions, &foundAppOptions, &errorMessage)) {
+        if (!PluginManager::parseOptions(argsParser.pluginArguments, {}, &foundAppOptions,
+                                         &errorMessage)) {
             displayError(errorMessage);
             printHelp();
             return -1;
@@ -340,41 +629,16 @@ int __main__(LoaderSpec *loadSpec) {
     }
 
     // Show version or full help information
-    if (foundAppOptions.contains(QLatin1String(VERSION_OPTION1)) ||
-        foundAppOptions.contains(VERSION_OPTION2)) {
+    if (argsParser.showVersion) {
         printVersion(coreplugin);
         return 0;
     }
 
-    if (foundAppOptions.contains(QLatin1String(HELP_OPTION1)) ||
-        foundAppOptions.contains(QLatin1String(HELP_OPTION2))) {
+    if (argsParser.showHelp) {
         printHelp();
         return 0;
     }
 
-    std::optional<SingleApplication> singleHook;
-    if (loadSpec->single) {
-        // Initialize singleton handle
-        singleHook.emplace(qApp, true, opts);
-        if (auto &single = *singleHook; !single.isPrimary()) {
-            qCDebug(ckLoader) << "primary instance already running. PID:" << single.primaryPid();
-
-            // This eventually needs moved into the NotepadNextApplication to keep
-            // sending/receiving logic in the same place
-            QByteArray buffer;
-            QDataStream stream(&buffer, QIODevice::WriteOnly);
-
-            stream << PluginManager::serializedArguments();
-            single.sendMessage(buffer);
-
-            qCDebug(ckLoader) << "secondary instance closing...";
-
-            return 0;
-        } else {
-            qCDebug(ckLoader) << "primary instance initializing...";
-        }
-    }
-
     Logger logger;
     RuntimeInterface::setLogger(&logger);
     qInstallMessageHandler([](QtMsgType type, const QMessageLogContext &context, const QString &msg) {
@@ -391,7 +655,7 @@ int __main__(LoaderSpec *loadSpec) {
     loadSpec->beforeLoadPlugins();
 
     // Update loader text
-    splash.showMessage(QCoreApplication::translate("Application", "Loading plugins..."));
+    splash.showStatus(QCoreApplication::translate("Application", "Loading plugins..."));
 
     // Load all plugins
     PluginManager::loadPlugins();
@@ -402,18 +666,12 @@ int __main__(LoaderSpec *loadSpec) {
 
     loadSpec->afterLoadPlugins();
 
-    if (singleHook.has_value()) {
-        // Set up remote arguments handler
-        QObject::connect(&singleHook.value(), &SingleApplication::receivedMessage,
-                         [&](quint32 instanceId, QByteArray message) {
-                             QDataStream stream(&message, QIODevice::ReadOnly);
-                             QString msg;
-                             stream >> msg;
-                             qCDebug(ckLoader).noquote().nospace()
-                                 << " remote message from " << instanceId << ", " << msg;
-                             pluginManager.remoteArguments(msg, nullptr);
-                         });
+    // Handle the messages received during loading
+    remoteHandler.pluginsLoaded = true;
+    for (const auto &item : std::as_const(remoteHandler.pendingMessages)) {
+        remoteHandler.handle(item.first, item.second);
     }
+    remoteHandler.pendingMessages.clear();
 
     // shutdown plugin manager on the exit
     QObject::connect(&a, &QApplication::aboutToQuit, &pluginManager, &PluginManager::shutdown);
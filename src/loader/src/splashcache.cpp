@@ -0,0 +1,139 @@
+#include "splashcache.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+namespace Loader {
+
+    static const quint32 CACHE_MAGIC = 0x434b5343; // CKSC
+    static const quint32 CACHE_VERSION = 1;
+
+    struct SourceStamp {
+        QString path;
+        qint64 size = -1;
+        qint64 mtime = -1;
+
+        static SourceStamp fromPath(const QString &path) {
+            SourceStamp stamp;
+            stamp.path = QFileInfo(path).absoluteFilePath();
+            QFileInfo info(stamp.path);
+            if (info.exists()) {
+                stamp.size = info.size();
+                stamp.mtime = info.lastModified().toMSecsSinceEpoch();
+            }
+            return stamp;
+        }
+
+        bool operator==(const SourceStamp &other) const {
+            return path == other.path && size == other.size && mtime == other.mtime;
+        }
+    };
+
+    static inline QDataStream &operator<<(QDataStream &out, const SourceStamp &stamp) {
+        return out << stamp.path << stamp.size << stamp.mtime;
+    }
+
+    static inline QDataStream &operator>>(QDataStream &in, SourceStamp &stamp) {
+        return in >> stamp.path >> stamp.size >> stamp.mtime;
+    }
+
+    static inline QDataStream &operator<<(QDataStream &out, const SplashText &text) {
+        return out << text.pos << text.alignment << text.fontSize << text.fontColor
+                   << text.maxWidth << text.text;
+    }
+
+    static inline QDataStream &operator>>(QDataStream &in, SplashText &text) {
+        return in >> text.pos >> text.alignment >> text.fontSize >> text.fontColor >>
+               text.maxWidth >> text.text;
+    }
+
+    /*!
+        Loads the cache if it was created from \a configPath for \a dpr and neither the
+        configuration nor the splash image has been modified since.
+    */
+    bool SplashCache::load(const QString &filename, const QString &configPath, qreal dpr) {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic, version;
+        in >> magic >> version;
+        if (magic != CACHE_MAGIC || version != CACHE_VERSION) {
+            return false;
+        }
+
+        SourceStamp configStamp, imageStamp;
+        double cachedDpr;
+        in >> configStamp >> imageStamp >> cachedDpr;
+        if (in.status() != QDataStream::Ok || cachedDpr != dpr ||
+            !(configStamp == SourceStamp::fromPath(configPath)) ||
+            !(imageStamp == SourceStamp::fromPath(imageStamp.path))) {
+            return false;
+        }
+
+        SplashConfig cachedConfig;
+        in >> cachedConfig.splashImage >> cachedConfig.splashSize >>
+            cachedConfig.splashSettings.size >> cachedConfig.splashSettings.texts;
+
+        // Raw pixels, read straight into the image without decoding
+        qint32 width, height;
+        qint64 bytesPerLine;
+        in >> width >> height >> bytesPerLine;
+        if (in.status() != QDataStream::Ok || width <= 0 || height <= 0) {
+            return false;
+        }
+
+        QImage cachedImage(width, height, QImage::Format_ARGB32_Premultiplied);
+        if (cachedImage.isNull() || cachedImage.bytesPerLine() != bytesPerLine) {
+            return false;
+        }
+        auto bytes = cachedImage.sizeInBytes();
+        if (in.readRawData(reinterpret_cast<char *>(cachedImage.bits()), int(bytes)) != bytes) {
+            return false;
+        }
+        cachedImage.setDevicePixelRatio(dpr);
+
+        config = std::move(cachedConfig);
+        image = std::move(cachedImage);
+        return true;
+    }
+
+    /*!
+        Writes the parsed configuration and the scaled image, \a imagePath is the splash image
+        source that the cache will be validated against.
+    */
+    bool SplashCache::save(const QString &filename, const QString &configPath,
+                           const QString &imagePath, qreal dpr) const {
+        QImage raw = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        if (raw.isNull()) {
+            return false;
+        }
+
+        QDir().mkpath(QFileInfo(filename).absolutePath());
+
+        QSaveFile file(filename);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return false;
+        }
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << CACHE_MAGIC << CACHE_VERSION << SourceStamp::fromPath(configPath)
+            << SourceStamp::fromPath(imagePath) << double(dpr);
+        out << config.splashImage << config.splashSize << config.splashSettings.size
+            << config.splashSettings.texts;
+        out << qint32(raw.width()) << qint32(raw.height()) << qint64(raw.bytesPerLine());
+        out.writeRawData(reinterpret_cast<const char *>(raw.constBits()), int(raw.sizeInBytes()));
+
+        return out.status() == QDataStream::Ok && file.commit();
+    }
+
+}
@@ -0,0 +1,23 @@
+#ifndef CHORUSKIT_SPLASHCACHE_H
+#define CHORUSKIT_SPLASHCACHE_H
+
+#include <QtGui/QImage>
+
+#include "splashconfig.h"
+
+namespace Loader {
+
+    struct SplashCache {
+        SplashConfig config;
+
+        // Splash image scaled for the device pixel ratio, premultiplied ARGB32
+        QImage image;
+
+        bool load(const QString &filename, const QString &configPath, qreal dpr);
+        bool save(const QString &filename, const QString &configPath, const QString &imagePath,
+                  qreal dpr) const;
+    };
+
+}
+
+#endif // CHORUSKIT_SPLASHCACHE_H
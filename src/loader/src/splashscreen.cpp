@@ -8,10 +8,14 @@
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
+#include <QtCore/QThread>
+#include <QtGui/QFontDatabase>
+#include <QtGui/QPaintEvent>
 #include <QtGui/QScreen>
 
 #include "loaderutils.h"
 
+#include "splashcache.h"
 #include "splashconfig.h"
 
 namespace Loader {
@@ -34,17 +38,46 @@ namespace Loader {
         return image;
     }
 
-    SplashScreen::SplashScreen(QScreen *screen) : QSplashScreen(screen) {
+    static const char STATUS_TEXT_ID[] = "_status";
+
+    SplashScreen::SplashScreen(QScreen *screen)
+        : QSplashScreen(screen), m_fontsWarmedUp(false), m_fontsReady(false),
+          m_staticLayerHasTexts(false) {
         m_showTexts = false;
-        m_texts.insert("_status", {});
+        m_texts.insert(STATUS_TEXT_ID, {});
 
         connect(this, &QSplashScreen::messageChanged, this, &SplashScreen::_q_messageChanged);
+
+        // Populating the font database takes a long time, do it while the image is shown
+        m_fontThread = QThread::create([this] {
+            QFontDatabase::families();
+            QFontDatabase::systemFont(QFontDatabase::GeneralFont);
+            m_fontsWarmedUp.store(true, std::memory_order_release);
+        });
+        m_fontThread->setParent(this);
+        connect(m_fontThread, &QThread::finished, this, [this] {
+            if (m_showTexts && isVisible())
+                repaint();
+        });
+        m_fontThread->start(QThread::LowPriority);
     }
 
     SplashScreen::~SplashScreen() {
+        m_fontThread->wait();
     }
 
-    void SplashScreen::applyConfig(const QString &fileName) {
+    void SplashScreen::applyConfig(const QString &fileName, const QString &cacheFileName) {
+        qreal dpr = screen()->devicePixelRatio();
+
+        // Skip parsing and decoding if nothing has changed since the last launch
+        SplashCache cache;
+        if (!cacheFileName.isEmpty() && cache.load(cacheFileName, fileName, dpr)) {
+            setPixmap(QPixmap::fromImage(cache.image));
+            invalidateLayers();
+            applyTextSettings(cache.config.splashSettings);
+            return;
+        }
+
         QString splashImagePath;
         QImage splashImage;
         QSize splashSize;
@@ -68,6 +101,7 @@ namespace Loader {
 
         splashImage = QImage(splashImagePath);
 
+        bool cacheable = !splashImage.isNull();
         if (splashImage.isNull()) {
             splashImage = generateTextImage(qApp->applicationDisplayName());
             splashSize = splashImage.size();
@@ -80,17 +114,28 @@ namespace Loader {
         // Setup splash
         QPixmap pixmap;
         if (splashImagePath.endsWith(".svg", Qt::CaseInsensitive)) {
-            pixmap = QIcon(splashImagePath).pixmap(splashSize * screen()->devicePixelRatio());
+            pixmap = QIcon(splashImagePath).pixmap(splashSize * dpr);
         } else {
             pixmap = QPixmap::fromImage(
-                splashImage.scaled(splashSize * screen()->devicePixelRatio(), Qt::KeepAspectRatio,
-                                   Qt::SmoothTransformation));
+                splashImage.scaled(splashSize * dpr, Qt::KeepAspectRatio, Qt::SmoothTransformation));
         }
-        pixmap.setDevicePixelRatio(screen()->devicePixelRatio());
+        pixmap.setDevicePixelRatio(dpr);
         setPixmap(pixmap);
+        invalidateLayers();
+
+        applyTextSettings(configFile.splashSettings);
+
+        if (!cacheFileName.isEmpty() && cacheable) {
+            cache.config = configFile;
+            cache.image = pixmap.toImage();
+            if (!cache.save(cacheFileName, fileName, splashImagePath, dpr)) {
+                qWarning() << "Loader::SplashScreen: failed to write splash cache" << cacheFileName;
+            }
+        }
+    }
 
-        for (auto it = configFile.splashSettings.texts.begin();
-             it != configFile.splashSettings.texts.end(); ++it) {
+    void SplashScreen::applyTextSettings(const SplashSettings &settings) {
+        for (auto it = settings.texts.begin(); it != settings.texts.end(); ++it) {
             const auto &item = it.value();
             SplashScreen::Attribute attr;
             attr.pos = item.pos.size() == 2 ? QPoint(item.pos[0], item.pos[1]) : attr.pos;
@@ -106,84 +151,71 @@ namespace Loader {
     void SplashScreen::setTextAttribute(const QString &id, const SplashScreen::Attribute &attr) {
         m_texts[id] = attr;
 
+        m_layouts.remove(id);
+        if (id != QLatin1String(STATUS_TEXT_ID))
+            m_staticLayer = {};
+
         if (m_showTexts && isVisible())
             repaint();
     }
 
     void SplashScreen::setText(const QString &id, const QString &text) {
         auto it = m_texts.find(id);
-        if (it == m_texts.end())
+        if (it == m_texts.end() || it->text == text)
             return;
         it->text = text;
 
-        if (m_showTexts && isVisible())
+        if (id != QLatin1String(STATUS_TEXT_ID)) {
+            m_layouts.remove(id);
+            m_staticLayer = {};
+            if (m_showTexts && isVisible())
+                repaint();
+            return;
+        }
+
+        // Only the status message changes while plugins are loading, redraw its area only
+        QRect oldRect = m_layouts.value(id).rect;
+        m_layouts.remove(id);
+
+        bool wasReady = m_fontsReady;
+        if (!isVisible() || !textsReady())
+            return;
+        if (!wasReady) {
             repaint();
+            return;
+        }
+        repaint(QRegion(oldRect) + textLayout(id).rect);
     }
 
+    // Paints the cached background and texts, the status message is the only text drawn live
     void SplashScreen::drawContents(QPainter *painter) {
         // QSplashScreen::drawContents(painter);
 
-        if (!m_showTexts) {
-            return;
+        bool withTexts = textsReady();
+        if (m_staticLayer.isNull() || m_staticLayerHasTexts != withTexts) {
+            updateStaticLayer(withTexts);
         }
 
-        // Draw texts
-        for (const auto &item : std::as_const(m_texts)) {
-            const Attribute &attr = item;
-
-            QFont font = Loader::systemDefaultFont();
-            font.setPixelSize(attr.fontSize);
-            QFontMetrics fm(font);
-
-            // Calculate base position, supporting negative coordinates (relative to right/bottom)
-            QPoint pos(attr.pos);
-            if (pos.x() < 0) {
-                pos.rx() += this->width();
-            }
-            if (pos.y() < 0) {
-                pos.ry() += this->height();
-            }
+        const QRect rect =
+            painter->hasClipping() ? painter->clipBoundingRect().toAlignedRect() : this->rect();
+        qreal dpr = m_staticLayer.devicePixelRatio();
+        painter->drawPixmap(rect, m_staticLayer,
+                            QRectF(QPointF(rect.topLeft()) * dpr, QSizeF(rect.size()) * dpr));
 
-            // Determine text width
-            int textWidth = fm.horizontalAdvance(item.text);
-            int maxWidth = attr.maxWidth > 0 ? attr.maxWidth : this->width();
-            int actualWidth = qMin(textWidth, maxWidth);
-            
-            // Calculate text rectangle based on alignment
-            QRect textRect;
-            int textHeight = fm.height();
-            
-            // Horizontal alignment
-            if (attr.alignment & Qt::AlignHCenter) {
-                textRect.setX(pos.x() - actualWidth / 2);
-            } else if (attr.alignment & Qt::AlignRight) {
-                textRect.setX(pos.x() - actualWidth);
-            } else { // Qt::AlignLeft (default)
-                textRect.setX(pos.x());
-            }
-            
-            // Vertical alignment
-            if (attr.alignment & Qt::AlignVCenter) {
-                textRect.setY(pos.y() - textHeight / 2);
-            } else if (attr.alignment & Qt::AlignBottom) {
-                textRect.setY(pos.y() - textHeight);
-            } else { // Qt::AlignTop (default)
-                textRect.setY(pos.y());
-            }
-            
-            textRect.setWidth(actualWidth);
-            textRect.setHeight(textHeight);
+        if (withTexts && textLayout(STATUS_TEXT_ID).rect.intersects(rect)) {
+            drawText(painter, STATUS_TEXT_ID);
+        }
+    }
 
-            // Handle text eliding if needed
-            QString displayText = textWidth > actualWidth
-                                  ? fm.elidedText(item.text, Qt::ElideRight, actualWidth)
-                                  : item.text;
+    void SplashScreen::paintEvent(QPaintEvent *event) {
+        QPainter painter(this);
+        painter.setClipRect(event->rect());
+        drawContents(&painter);
+    }
 
-            // Draw the text
-            painter->setPen(QPen(attr.fontColor));
-            painter->setFont(font);
-            painter->drawText(textRect, attr.alignment, displayText);
-        }
+    void SplashScreen::resizeEvent(QResizeEvent *event) {
+        invalidateLayers();
+        QSplashScreen::resizeEvent(event);
     }
 
     void SplashScreen::showTexts() {
@@ -192,12 +224,126 @@ namespace Loader {
             repaint();
     }
 
+    bool SplashScreen::textsReady() {
+        if (!m_showTexts) {
+            return false;
+        }
+        if (!m_fontsReady) {
+            if (!m_fontsWarmedUp.load(std::memory_order_acquire)) {
+                return false;
+            }
+            m_fontsReady = true;
+            m_baseFont = Loader::systemDefaultFont();
+            invalidateLayers();
+        }
+        return true;
+    }
+
+    SplashScreen::TextLayout SplashScreen::layoutText(const Attribute &attr) const {
+        TextLayout layout;
+        layout.font = m_baseFont;
+        layout.font.setPixelSize(attr.fontSize);
+        QFontMetrics fm(layout.font);
+
+        // Calculate base position, supporting negative coordinates (relative to right/bottom)
+        QPoint pos(attr.pos);
+        if (pos.x() < 0) {
+            pos.rx() += this->width();
+        }
+        if (pos.y() < 0) {
+            pos.ry() += this->height();
+        }
+
+        // Determine text width
+        int textWidth = fm.horizontalAdvance(attr.text);
+        int maxWidth = attr.maxWidth > 0 ? attr.maxWidth : this->width();
+        int actualWidth = qMin(textWidth, maxWidth);
+
+        // Calculate text rectangle based on alignment
+        QRect &textRect = layout.rect;
+        int textHeight = fm.height();
+
+        // Horizontal alignment
+        if (attr.alignment & Qt::AlignHCenter) {
+            textRect.setX(pos.x() - actualWidth / 2);
+        } else if (attr.alignment & Qt::AlignRight) {
+            textRect.setX(pos.x() - actualWidth);
+        } else { // Qt::AlignLeft (default)
+            textRect.setX(pos.x());
+        }
+
+        // Vertical alignment
+        if (attr.alignment & Qt::AlignVCenter) {
+            textRect.setY(pos.y() - textHeight / 2);
+        } else if (attr.alignment & Qt::AlignBottom) {
+            textRect.setY(pos.y() - textHeight);
+        } else { // Qt::AlignTop (default)
+            textRect.setY(pos.y());
+        }
+
+        textRect.setWidth(actualWidth);
+        textRect.setHeight(textHeight);
+
+        // Handle text eliding if needed
+        layout.text = textWidth > actualWidth
+                          ? fm.elidedText(attr.text, Qt::ElideRight, actualWidth)
+                          : attr.text;
+        return layout;
+    }
+
+    const SplashScreen::TextLayout &SplashScreen::textLayout(const QString &id) {
+        auto it = m_layouts.find(id);
+        if (it == m_layouts.end()) {
+            it = m_layouts.insert(id, layoutText(m_texts.value(id)));
+        }
+        return it.value();
+    }
+
+    void SplashScreen::drawText(QPainter *painter, const QString &id) {
+        const auto &attr = m_texts[id];
+        const auto &layout = textLayout(id);
+        if (layout.text.isEmpty())
+            return;
+
+        painter->setPen(QPen(attr.fontColor));
+        painter->setFont(layout.font);
+        painter->drawText(layout.rect, attr.alignment, layout.text);
+    }
+
+    void SplashScreen::updateStaticLayer(bool withTexts) {
+        qreal dpr = devicePixelRatioF();
+        m_staticLayer = QPixmap(size() * dpr);
+        m_staticLayer.setDevicePixelRatio(dpr);
+        m_staticLayer.fill(Qt::transparent);
+        m_staticLayerHasTexts = withTexts;
+
+        QPainter painter(&m_staticLayer);
+        painter.drawPixmap(0, 0, pixmap());
+        if (withTexts) {
+            for (auto it = m_texts.cbegin(); it != m_texts.cend(); ++it) {
+                if (it.key() != QLatin1String(STATUS_TEXT_ID))
+                    drawText(&painter, it.key());
+            }
+        }
+    }
+
+    void SplashScreen::invalidateLayers() {
+        m_layouts.clear();
+        m_staticLayer = {};
+    }
+
     void SplashScreen::mousePressEvent(QMouseEvent *event) {
         // No hide
     }
 
+    void SplashScreen::showStatus(const QString &message) {
+        setText(STATUS_TEXT_ID, message);
+    }
+
+    // Emitted by showMessage(), which repaints the whole splash right after
     void SplashScreen::_q_messageChanged(const QString &message) {
-        setText("_status", message);
+        m_texts[STATUS_TEXT_ID].text = message;
+        m_layouts.remove(STATUS_TEXT_ID);
     }
 
     void SplashScreen::closeEvent(QCloseEvent *event) {
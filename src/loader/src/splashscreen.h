@@ -1,10 +1,16 @@
 #ifndef CHORUSKIT_SPLASHSCREEN_H
 #define CHORUSKIT_SPLASHSCREEN_H
 
+#include <atomic>
+
 #include <QSplashScreen>
 
+class QThread;
+
 namespace Loader {
 
+    struct SplashSettings;
+
     class SplashScreen : public QSplashScreen {
         Q_OBJECT
     public:
@@ -20,12 +26,16 @@ namespace Loader {
             QString text;
         };
 
-        void applyConfig(const QString &fileName);
+        void applyConfig(const QString &fileName, const QString &cacheFileName = {});
 
     public:
         void setTextAttribute(const QString &id, const Attribute &attr);
         Q_INVOKABLE void setText(const QString &id, const QString &text);
 
+        // Redraws only the area of the status message, unlike showMessage() which repaints the
+        // whole splash
+        void showStatus(const QString &message);
+
         // The first display of text takes a relatively long time,
         // So we firstly display the image background, then show texts
         void showTexts();
@@ -36,13 +46,41 @@ namespace Loader {
     protected:
         void drawContents(QPainter *painter) override;
 
+        void paintEvent(QPaintEvent *event) override;
+        void resizeEvent(QResizeEvent *event) override;
         void mousePressEvent(QMouseEvent *event) override;
         void closeEvent(QCloseEvent *event) override;
 
     private:
+        struct TextLayout {
+            QFont font;
+            QRect rect;
+            QString text;
+        };
+
         bool m_showTexts;
         QHash<QString, Attribute> m_texts;
 
+        // Font database is populated in a worker thread, texts are drawn after it finishes
+        QThread *m_fontThread;
+        std::atomic_bool m_fontsWarmedUp;
+        bool m_fontsReady;
+        QFont m_baseFont;
+
+        // Background and all texts except the status message, at the screen's pixel ratio
+        QPixmap m_staticLayer;
+        bool m_staticLayerHasTexts;
+        QHash<QString, TextLayout> m_layouts;
+
+        void applyTextSettings(const SplashSettings &settings);
+
+        bool textsReady();
+        TextLayout layoutText(const Attribute &attr) const;
+        const TextLayout &textLayout(const QString &id);
+        void drawText(QPainter *painter, const QString &id);
+        void updateStaticLayer(bool withTexts);
+        void invalidateLayers();
+
         void _q_messageChanged(const QString &message);
     };
 